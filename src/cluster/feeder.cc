@@ -137,6 +137,7 @@ void Feeder::LoadData(const util::Config &load_desc,
   };
 
   util::Config tmp_desc = load_desc;
+  tmp_desc.set_str("source_file", path);
   tmp_desc.set_str("file", target_path);
   loader_.Load(tmp_desc, target_worker);
 }
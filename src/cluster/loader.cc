@@ -17,9 +17,11 @@
 #include "cluster/loader.h"
 #include "cluster/batch_info.h"
 #include "cluster/controller.h"
+#include "cluster/splitter.h"
 #include "util/hostname.h"
 #include "util/latch.h"
 #include "util/scope_guard.h"
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -28,6 +30,8 @@
 #include <fcntl.h>
 #include <fstream>
 #include <glog/logging.h>
+#include <map>
+#include <set>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -61,10 +65,46 @@ util::Config Loader::GetPartitionFilter(const std::string &table_name,
                            {"values", values}});
 }
 
+std::vector<size_t>
+Loader::GetPartitionColumns(const util::Config &load_desc) {
+  auto table_name = load_desc.str("table");
+  auto &partitioning = controller_.tables_partitioning().at(table_name);
+  auto dimensions = controller_.tables_configs().at(table_name).sublist(
+      "dimensions");
+  auto load_cols = load_desc.strlist("columns", {});
+
+  // Input columns order is resolved the same way as in input::LoaderDesc:
+  std::vector<size_t> key_columns;
+  for (auto &col : partitioning.columns()) {
+    auto dim_it = std::find_if(
+        dimensions.begin(), dimensions.end(),
+        [&col](auto &dim) { return dim.str("name") == col; });
+    if (dim_it == dimensions.end()) {
+      throw std::runtime_error("Partitioning column '" + col +
+                               "' is not a dimension of table: " + table_name);
+    }
+    if (load_cols.empty()) {
+      key_columns.push_back(std::distance(dimensions.begin(), dim_it));
+    } else {
+      auto field = dim_it->str("field", col);
+      auto it = std::find(load_cols.begin(), load_cols.end(), field);
+      if (it == load_cols.end()) {
+        throw std::runtime_error("Column name '" + field +
+                                 "' is not specified in load spec");
+      }
+      key_columns.push_back(std::distance(load_cols.begin(), it));
+    }
+  }
+  return key_columns;
+}
+
 void Loader::Load(const util::Config &load_desc, const std::string &worker_id) {
   auto tmpfile = ExtractFiles(load_desc.str("file"));
 
+  // Keep the original path, so workers can identify a replayed batch:
   util::Config tmp_desc = load_desc;
+  tmp_desc.set_str("source_file",
+                   load_desc.str("source_file", load_desc.str("file")));
   tmp_desc.set_str("file", tmpfile);
 
   auto table_name = load_desc.str("table");
@@ -107,27 +147,46 @@ void Loader::Load(const util::Config &load_desc, const std::string &worker_id) {
       LOG(WARNING) << "Can't madvise() on file: " << tmpfile;
     }
 
+    // Group own workers by partition (there can be several replicas):
     auto &workers_parts =
         controller_.tables_plans().at(table_name).workers_partitions();
-    std::vector<std::string> own_workers;
+    std::map<uint32_t, std::vector<std::string>> partition_workers;
+    size_t own_workers = 0;
     for (auto &it : workers_parts) {
       auto &worker_id = it.first;
       if (controller_.IsOwnWorker(worker_id)) {
-        own_workers.emplace_back(worker_id);
+        partition_workers[it.second].emplace_back(worker_id);
+        ++own_workers;
       }
     }
 
-    util::CountDownLatch latch(own_workers.size());
+    // Parse the input only once, and let every worker load its own rows:
+    std::set<uint32_t> partitions;
+    for (auto &it : partition_workers) {
+      partitions.insert(it.first);
+    }
+    auto &partitioning = controller_.tables_partitioning().at(table_name);
+    PartitionSplitter splitter(GetPartitionColumns(load_desc),
+                               partitioning.mapping(), partitioning.total());
+    auto partition_files = splitter.Split(addr, size, partitions);
+    util::ScopeGuard remove_files = [&partition_files]() {
+      for (auto &it : partition_files) {
+        fs::remove(it.second);
+      }
+    };
+
+    util::CountDownLatch latch(own_workers);
 
-    for (auto &worker_id : own_workers) {
-      auto partition_filter = GetPartitionFilter(table_name, worker_id);
-      tmp_desc.set_sub("partition_filter", partition_filter);
+    for (auto &it : partition_workers) {
+      tmp_desc.set_str("file", partition_files.at(it.first));
       auto data = tmp_desc.dump();
 
-      load_pool_.enqueue([&, worker_id, data] {
-        SendRequest(worker_id, data);
-        latch.CountDown();
-      });
+      for (auto &worker_id : it.second) {
+        load_pool_.enqueue([&, worker_id, data] {
+          SendRequest(worker_id, data);
+          latch.CountDown();
+        });
+      }
     }
 
     // Wait for all workers to load the data, then cleanup
@@ -45,6 +45,8 @@ private:
   util::Config GetPartitionFilter(const std::string &table_name,
                                   const std::string &worker_id);
 
+  std::vector<size_t> GetPartitionColumns(const util::Config &load_desc);
+
   void SendRequest(const std::string &url, const std::string &data);
 
   std::string ExtractFiles(const std::string &path);
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cluster/splitter.h"
+#include "util/crc32.h"
+#include "util/scope_guard.h"
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace viya {
+namespace cluster {
+
+namespace fs = boost::filesystem;
+
+struct PartitionOutput {
+  int fd;
+  std::string file;
+  std::vector<char> buf;
+
+  void Flush() {
+    for (size_t written = 0; written < buf.size();) {
+      auto n = write(fd, buf.data() + written, buf.size() - written);
+      if (n == -1) {
+        throw std::runtime_error("Can't write to temporary file: " + file);
+      }
+      written += n;
+    }
+    buf.clear();
+  }
+};
+
+PartitionSplitter::PartitionSplitter(const std::vector<size_t> &key_columns,
+                                     const std::vector<uint32_t> &mapping,
+                                     size_t total_partitions,
+                                     size_t buffer_size)
+    : key_columns_(key_columns), mapping_(mapping),
+      total_partitions_(total_partitions), buffer_size_(buffer_size) {}
+
+uint32_t PartitionSplitter::GetKeyValue(const char *line,
+                                        const char *line_end) const {
+  uint32_t hash = 0;
+  for (auto col : key_columns_) {
+    const char *value = line;
+    for (size_t idx = 0; idx < col && value < line_end; ++idx) {
+      value = (const char *)memchr(value, '\t', line_end - value);
+      value = value == nullptr ? line_end : value + 1;
+    }
+    const char *value_end =
+        (const char *)memchr(value, '\t', line_end - value);
+    if (value_end == nullptr) {
+      value_end = line_end;
+    }
+    hash = util::crc32(hash, value, value_end - value);
+  }
+  return hash % total_partitions_;
+}
+
+std::map<uint32_t, std::string>
+PartitionSplitter::Split(const char *buf, size_t size,
+                         const std::set<uint32_t> &partitions) {
+  std::map<uint32_t, PartitionOutput> outputs;
+  util::ScopeGuard cleanup = [&outputs]() {
+    for (auto &it : outputs) {
+      close(it.second.fd);
+      fs::remove(it.second.file);
+    }
+  };
+
+  for (auto partition : partitions) {
+    char tmpfile[] = "/tmp/viyadb-data.XXXXXX";
+    auto fd = mkstemp(tmpfile);
+    if (fd == -1) {
+      throw std::runtime_error("Can't create temporary file!");
+    }
+    auto &output = outputs[partition];
+    output.fd = fd;
+    output.file = tmpfile;
+    output.buf.reserve(buffer_size_);
+  }
+
+  const char *buf_end = buf + size;
+  for (const char *lstart = buf; lstart < buf_end;) {
+    const char *lend = (const char *)memchr(lstart, '\n', buf_end - lstart);
+    if (lend == nullptr) {
+      lend = buf_end;
+    }
+    if (lend > lstart) {
+      uint32_t value = GetKeyValue(lstart, lend);
+      auto it = value < mapping_.size() ? outputs.find(mapping_[value])
+                                        : outputs.end();
+      if (it != outputs.end()) {
+        auto &output = it->second;
+        output.buf.insert(output.buf.end(), lstart, lend);
+        output.buf.push_back('\n');
+        if (output.buf.size() >= buffer_size_) {
+          output.Flush();
+        }
+      }
+    }
+    lstart = lend + 1;
+  }
+
+  std::map<uint32_t, std::string> files;
+  for (auto &it : outputs) {
+    it.second.Flush();
+    files.emplace(it.first, it.second.file);
+  }
+  cleanup.dismiss();
+
+  for (auto &it : outputs) {
+    close(it.second.fd);
+  }
+  return files;
+}
+
+} // namespace cluster
+} // namespace viya
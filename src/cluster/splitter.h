@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_CLUSTER_SPLITTER_H_
+#define VIYA_CLUSTER_SPLITTER_H_
+
+#include "util/macros.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace viya {
+namespace cluster {
+
+/**
+ * Splits TSV input into per-partition files in a single pass. Every line is
+ * hashed on its partitioning columns exactly like the partition filter of the
+ * upsert code does, so that workers can load their files as is.
+ */
+class PartitionSplitter {
+public:
+  /**
+   * @param key_columns Indices of partitioning columns in the input
+   * @param mapping Partition of every key value
+   * @param total_partitions Number of key values
+   * @param buffer_size Size of buffer accumulated per partition before writing
+   */
+  PartitionSplitter(const std::vector<size_t> &key_columns,
+                    const std::vector<uint32_t> &mapping,
+                    size_t total_partitions, size_t buffer_size = 1048576);
+  DISALLOW_COPY_AND_MOVE(PartitionSplitter);
+
+  /**
+   * Writes lines that belong to the given partitions into temporary files.
+   * Lines of other partitions are skipped.
+   *
+   * @return temporary file per partition
+   */
+  std::map<uint32_t, std::string> Split(const char *buf, size_t size,
+                                        const std::set<uint32_t> &partitions);
+
+private:
+  uint32_t GetKeyValue(const char *line, const char *line_end) const;
+
+private:
+  const std::vector<size_t> key_columns_;
+  const std::vector<uint32_t> mapping_;
+  const size_t total_partitions_;
+  const size_t buffer_size_;
+};
+
+} // namespace cluster
+} // namespace viya
+
+#endif // VIYA_CLUSTER_SPLITTER_H_
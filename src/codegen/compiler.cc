@@ -23,7 +23,9 @@
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <chrono>
 #include <cityhash/src/city.h>
+#include <ctime>
 #include <glog/logging.h>
+#include <future>
 #include <stdexcept>
 
 namespace viya {
@@ -33,7 +35,7 @@ namespace fs = boost::filesystem;
 namespace bi = boost::interprocess;
 namespace cr = std::chrono;
 
-Compiler::Compiler(const util::Config &config) {
+Compiler::Compiler(const util::Config &config) : background_(1) {
   cmd_ = {
     "g++",
     "-std=c++17",
@@ -58,19 +60,32 @@ Compiler::Compiler(const util::Config &config) {
     "-lroaring",
     "-lviya_util",
     "-Wl,--no-whole-archive",
-// <== end of dependencies
+    // <== end of dependencies
+  };
 
 // start optimizations ==>
 #ifdef NDEBUG
+  optimized_flags_ = {
     "-O2",
     "-funroll-loops",
+    "-ftree-vectorize",
     "-march=native",
     "-fvisibility=hidden",
     "-fno-implement-inlines",
     "-Wno-unused-parameter",
     "-Wno-unused-variable",
     "-DNDEBUG",
+  };
+  fast_flags_ = {
+    "-O0",
+    "-fvisibility=hidden",
+    "-Wno-unused-parameter",
+    "-Wno-unused-variable",
+    "-DNDEBUG",
+  };
+  optimize_after_ = config.num("optimize_after", 3);
 #else
+  optimized_flags_ = {
     "-Wall",
     "-Wextra",
     "-g",
@@ -78,9 +93,14 @@ Compiler::Compiler(const util::Config &config) {
 #if CODE_COVERAGE
     "--coverage",
 #endif // CODE_COVERAGE
+  };
+  // Everything is compiled without optimizations anyway:
+  fast_flags_ = optimized_flags_;
+  optimize_after_ = 0;
 #endif // NDEBUG
-    // <== end of optimizations
+  // <== end of optimizations
 
+  output_args_ = {
     "-shared",
     "-fPIC",
     "-x",
@@ -92,55 +112,366 @@ Compiler::Compiler(const util::Config &config) {
 
   path_ = config.str("state_dir", "/tmp/viyadb") + "/codegen";
   fs::create_directories(fs::path(path_));
+
+  long max_libraries = config.num("max_libraries", 1000);
+  if (max_libraries < 1) {
+    throw std::invalid_argument("At least one library must be cached");
+  }
+  max_libraries_ = max_libraries;
+
+  // Libraries that were not used for a long time (a week, by default) are
+  // most probably left by queries or tables that don't exist anymore:
+  RemoveStaleLibraries(config.num("library_ttl", 7 * 24 * 3600));
+
+  // Fixed includes of generated code are precompiled in background. Until the
+  // precompiled header is ready, the code is compiled with regular header:
+  std::string includes;
+  for (auto &header : PrecompiledHeaders()) {
+    includes += "#include <" + header + ">\n";
+  }
+  common_header_ = WriteHeader("common", includes);
+  for (auto tier : Tiers()) {
+    background_.enqueue([this, tier]() {
+      try {
+        Precompile(common_header_, tier);
+      } catch (std::exception &e) {
+        LOG(WARNING) << e.what();
+      }
+    });
+  }
+}
+
+const std::vector<std::string> &Compiler::PrecompiledHeaders() {
+  static const std::vector<std::string> headers = {
+      "algorithm",        "atomic",          "cfloat",
+      "cstddef",          "cstdint",         "cstdio",
+      "string",           "unordered_map",   "unordered_set",
+      "vector",           "db/dictionary.h", "db/segment.h",
+      "db/store.h",       "db/table.h",      "query/batch_decoder.h",
+      "query/cancel.h",   "query/cursor.h",  "query/output.h",
+      "query/parallel.h", "query/sample.h",  "query/stats.h",
+      "util/bitset.h",    "util/flat_map.h", "util/format.h",
+      "util/string.h"};
+  return headers;
 }
 
-std::shared_ptr<SharedLibrary> Compiler::Compile(const std::string &code) {
+uint64_t Compiler::CodeHash(const std::string &code) {
   std::string code_and_version(code + GIT_SHA1);
-  uint64_t code_hash =
-      CityHash64(code_and_version.c_str(), code_and_version.size());
+  return CityHash64(code_and_version.c_str(), code_and_version.size());
+}
 
-  auto library = libs_[code_hash];
-  if (library == nullptr) {
-    std::string prefix = path_ + "/" + std::to_string(code_hash);
-    std::string so_file = prefix + ".so";
-    std::string tmp_so_file = prefix + "_.so";
-    std::string lock_file = so_file + ".lock";
+std::vector<Compiler::Tier> Compiler::Tiers() const {
+  if (optimize_after_ == 0) {
+    return {Tier::OPTIMIZED};
+  }
+  return {Tier::FAST, Tier::OPTIMIZED};
+}
 
-    fs::ofstream(lock_file.c_str());
-    bi::file_lock fl(lock_file.c_str());
-    bi::scoped_lock<bi::file_lock> lock(fl);
+Compiler::Tier Compiler::InitialTier(uint64_t code_hash) const {
+  if (optimize_after_ == 0) {
+    return Tier::OPTIMIZED;
+  }
+  // Optimized library may be left by a previous run:
+  auto so_file = LibraryPrefix(code_hash, Tier::OPTIMIZED) + ".so";
+  return fs::exists(so_file) ? Tier::OPTIMIZED : Tier::FAST;
+}
 
-#ifndef NDEBUG
-    std::string cpp_file = prefix + ".cc";
-    std::ofstream out(cpp_file);
-    out << code.c_str();
-    out.close();
-    cmd_[cmd_.size() - 3] = cpp_file;
-#endif
+std::string Compiler::LibraryPrefix(uint64_t code_hash, Tier tier) const {
+  return path_ + "/" + std::to_string(code_hash) +
+         (tier == Tier::FAST ? "_fast" : "");
+}
+
+Compiler::Entry &Compiler::Install(uint64_t code_hash,
+                                   std::shared_ptr<SharedLibrary> library,
+                                   Tier tier, bool pinned) {
+  auto it = libs_.find(code_hash);
+  if (it == libs_.end()) {
+    it = libs_.emplace(code_hash, Entry{library, tier, 0, false, lru_.end()})
+             .first;
+    it->second.lru_pos = lru_.insert(lru_.end(), code_hash);
+  } else if (tier == Tier::OPTIMIZED && it->second.tier == Tier::FAST) {
+    // Queries that are running already keep their own reference to the
+    // fast library, so it's unloaded only when they all complete:
+    it->second.library = library;
+    it->second.tier = tier;
+  }
+  auto &entry = it->second;
+  if (pinned && !entry.pinned) {
+    entry.pinned = true;
+    lru_.erase(entry.lru_pos);
+    entry.lru_pos = lru_.end();
+  }
+  Touch(entry);
+
+  // Evicted libraries are closed once the last query using them completes:
+  while (lru_.size() > max_libraries_) {
+    DLOG(INFO) << "Evicting library: " << lru_.front();
+    libs_.erase(lru_.front());
+    lru_.pop_front();
+  }
+  return entry;
+}
+
+void Compiler::Touch(Entry &entry) {
+  if (!entry.pinned) {
+    lru_.splice(lru_.end(), lru_, entry.lru_pos);
+  }
+}
+
+std::shared_ptr<SharedLibrary> Compiler::Executed(uint64_t code_hash,
+                                                  Entry &entry,
+                                                  const std::string &code,
+                                                  const std::string &module) {
+  Touch(entry);
+  if (entry.tier == Tier::FAST && ++entry.executions >= optimize_after_ &&
+      pending_.insert(code_hash).second) {
+    background_.enqueue([this, code, module, code_hash]() {
+      try {
+        Load(code, module, code_hash, Tier::OPTIMIZED, false);
+      } catch (std::exception &e) {
+        LOG(WARNING) << "Optimized compilation failed: " << e.what();
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = libs_.find(code_hash);
+        if (it != libs_.end()) {
+          it->second.executions = 0;
+        }
+      }
+      std::lock_guard<std::mutex> guard(mutex_);
+      pending_.erase(code_hash);
+    });
+  }
+  return entry.library;
+}
+
+std::shared_ptr<SharedLibrary> Compiler::Load(const std::string &code,
+                                              const std::string &module,
+                                              uint64_t code_hash, Tier tier,
+                                              bool pinned) {
+  // Concurrent requests for the same library wait for a single build:
+  auto key = LibraryPrefix(code_hash, tier);
+  std::promise<std::shared_ptr<SharedLibrary>> promise;
+  std::shared_future<std::shared_ptr<SharedLibrary>> build;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = builds_.find(key);
+    if (it != builds_.end()) {
+      build = it->second;
+    } else {
+      builds_.emplace(key, promise.get_future().share());
+    }
+  }
+
+  if (build.valid()) {
+    auto library = build.get();
+    std::lock_guard<std::mutex> guard(mutex_);
+    return Install(code_hash, library, tier, pinned).library;
+  }
 
-    if (!fs::exists(so_file)) {
-      cmd_.back() = tmp_so_file;
+  try {
+    auto library = Build(code, module, code_hash, tier);
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &entry = Install(code_hash, library, tier, pinned);
+    builds_.erase(key);
+    promise.set_value(library);
+    return entry.library;
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    builds_.erase(key);
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+}
+
+std::shared_ptr<SharedLibrary> Compiler::Compile(const std::string &code,
+                                                 const std::string &module) {
+  uint64_t code_hash = CodeHash(module + code);
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = libs_.find(code_hash);
+    if (it != libs_.end() && it->second.tier == Tier::OPTIMIZED) {
+      return Install(code_hash, it->second.library, Tier::OPTIMIZED, true)
+          .library;
+    }
+  }
+  return Load(code, module, code_hash, Tier::OPTIMIZED, true);
+}
 
-      LOG(INFO) << boost::algorithm::join(cmd_, " ");
-      auto begin = cr::steady_clock::now();
+std::shared_ptr<SharedLibrary>
+Compiler::CompileTiered(const std::string &code, const std::string &module) {
+  uint64_t code_hash = CodeHash(module + code);
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = libs_.find(code_hash);
+    if (it != libs_.end()) {
+      return Executed(code_hash, it->second, code, module);
+    }
+  }
+
+  auto tier = InitialTier(code_hash);
+  auto library = Load(code, module, code_hash, tier, false);
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = libs_.find(code_hash);
+  if (it == libs_.end()) {
+    // Evicted already by concurrent compilations:
+    return library;
+  }
+  return Executed(code_hash, it->second, code, module);
+}
 
-      if (util::Process::RunWithInput(cmd_, code) != 0) {
-        throw std::runtime_error("Can't compile: " + code);
+std::shared_ptr<SharedLibrary>
+Compiler::CompileAsync(const std::string &code, const std::string &module) {
+  uint64_t code_hash = CodeHash(module + code);
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = libs_.find(code_hash);
+  if (it != libs_.end()) {
+    return Executed(code_hash, it->second, code, module);
+  }
+  if (pending_.insert(code_hash).second) {
+    background_.enqueue([this, code, module, code_hash]() {
+      try {
+        Load(code, module, code_hash, InitialTier(code_hash), false);
+      } catch (std::exception &e) {
+        LOG(WARNING) << "Background compilation failed: " << e.what();
       }
+      std::lock_guard<std::mutex> guard(mutex_);
+      pending_.erase(code_hash);
+    });
+  }
+  return nullptr;
+}
 
-      auto end = cr::steady_clock::now();
-      LOG(INFO) << "Compilation took "
-                << cr::duration_cast<cr::milliseconds>(end - begin).count()
-                << " ms" << std::endl;
+void Compiler::RemoveStaleLibraries(size_t ttl) {
+  auto expiration = std::time(nullptr) - static_cast<std::time_t>(ttl);
+  for (auto &entry : fs::directory_iterator(fs::path(path_))) {
+    auto &path = entry.path();
+    if (path.extension() != ".so" || !fs::is_regular_file(path) ||
+        fs::last_write_time(path) >= expiration) {
+      continue;
+    }
+    LOG(INFO) << "Removing stale library: " << path.string();
+    boost::system::error_code ec;
+    fs::remove(path, ec);
+    fs::remove(fs::path(path.string() + ".lock"), ec);
+    fs::remove(fs::path(path).replace_extension(".cc"), ec);
+  }
+}
+
+std::string Compiler::WriteHeader(const std::string &name,
+                                  const std::string &content) {
+  auto header_hash = CodeHash(content);
+  std::string header =
+      path_ + "/" + name + "_" + std::to_string(header_hash) + ".h";
 
-      fs::rename(fs::path(tmp_so_file), fs::path(so_file));
+  std::lock_guard<std::mutex> guard(build_mutexes_[header_hash % BUILD_LOCKS]);
+  if (!fs::exists(header)) {
+    std::string tmp_header = header + ".tmp";
+    std::ofstream out(tmp_header);
+    out << content;
+    out.close();
+    fs::rename(fs::path(tmp_header), fs::path(header));
+  }
+  return header;
+}
+
+void Compiler::Precompile(const std::string &header, Tier tier) {
+  // GCC picks a valid precompiled header from the .gch directory, so there's
+  // one file per optimization tier:
+  std::string tier_name = tier == Tier::FAST ? "fast" : "optimized";
+  std::string gch_dir = header + ".gch";
+  std::string gch_file = gch_dir + "/" + tier_name + ".gch";
+  std::string tmp_gch_file = header + "." + tier_name + ".tmp";
+  std::string lock_file = header + "." + tier_name + ".lock";
+
+  std::lock_guard<std::mutex> guard(
+      build_mutexes_[std::hash<std::string>{}(gch_file) % BUILD_LOCKS]);
+
+  fs::ofstream(lock_file.c_str());
+  bi::file_lock fl(lock_file.c_str());
+  bi::scoped_lock<bi::file_lock> lock(fl);
+
+  if (!fs::exists(gch_file)) {
+    std::vector<std::string> cmd(cmd_);
+    auto &flags = tier == Tier::FAST ? fast_flags_ : optimized_flags_;
+    cmd.insert(cmd.end(), flags.begin(), flags.end());
+    cmd.insert(cmd.end(),
+               {"-fPIC", "-x", "c++-header", header, "-o", tmp_gch_file});
+
+    LOG(INFO) << boost::algorithm::join(cmd, " ");
+    if (util::Process::Run(cmd) != 0) {
+      throw std::runtime_error("Can't precompile header: " + header);
+    }
+    fs::create_directories(fs::path(gch_dir));
+    fs::rename(fs::path(tmp_gch_file), fs::path(gch_file));
+  }
+}
+
+std::shared_ptr<SharedLibrary> Compiler::Build(const std::string &code,
+                                               const std::string &module,
+                                               uint64_t code_hash, Tier tier) {
+  std::string header = common_header_;
+  if (!module.empty()) {
+    // Module is precompiled on first use, so that all the libraries using it
+    // are compiled faster:
+    header = WriteHeader("module", module);
+    try {
+      Precompile(header, tier);
+    } catch (std::exception &e) {
+      LOG(WARNING) << e.what();
+    }
+  }
+
+  std::string prefix = LibraryPrefix(code_hash, tier);
+  std::string so_file = prefix + ".so";
+  std::string tmp_so_file = prefix + "_.so";
+  std::string lock_file = so_file + ".lock";
+
+  // File lock only protects from other processes, therefore the same library
+  // is not built concurrently by threads of this process as well:
+  std::lock_guard<std::mutex> guard(
+      build_mutexes_[(code_hash + static_cast<int>(tier)) % BUILD_LOCKS]);
+
+  fs::ofstream(lock_file.c_str());
+  bi::file_lock fl(lock_file.c_str());
+  bi::scoped_lock<bi::file_lock> lock(fl);
+
+  std::vector<std::string> cmd(cmd_);
+  auto &flags = tier == Tier::FAST ? fast_flags_ : optimized_flags_;
+  cmd.insert(cmd.end(), flags.begin(), flags.end());
+  cmd.insert(cmd.end(), {"-include", header});
+  cmd.insert(cmd.end(), output_args_.begin(), output_args_.end());
+
+#ifndef NDEBUG
+  std::string cpp_file = prefix + ".cc";
+  std::ofstream out(cpp_file);
+  out << code.c_str();
+  out.close();
+  cmd[cmd.size() - 3] = cpp_file;
+#endif
+
+  if (!fs::exists(so_file)) {
+    cmd.back() = tmp_so_file;
+
+    LOG(INFO) << boost::algorithm::join(cmd, " ");
+    auto begin = cr::steady_clock::now();
+
+    if (util::Process::RunWithInput(cmd, code) != 0) {
+      throw std::runtime_error("Can't compile: " + code);
     }
 
-    library = std::make_shared<SharedLibrary>(so_file);
-    libs_[code_hash] = library;
+    auto end = cr::steady_clock::now();
+    LOG(INFO) << "Compilation took "
+              << cr::duration_cast<cr::milliseconds>(end - begin).count()
+              << " ms" << std::endl;
+
+    fs::rename(fs::path(tmp_so_file), fs::path(so_file));
+  } else {
+    // Keeps the library from being removed as stale (see constructor):
+    fs::last_write_time(fs::path(so_file), std::time(nullptr));
   }
 
-  return library;
+  return std::make_shared<SharedLibrary>(so_file);
 }
 
 } // namespace codegen
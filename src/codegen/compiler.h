@@ -19,26 +19,125 @@
 
 #include "codegen/shared_library.h"
 #include "util/config.h"
+#include <ThreadPool/ThreadPool.h>
+#include <future>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace viya {
 namespace codegen {
 
 namespace util = viya::util;
 
+/**
+ * Compiles generated code into shared libraries. Query code is compiled in
+ * tiers: the first build uses cheap optimization flags, so that a new query
+ * starts running as soon as possible. After the same code was executed
+ * `optimize_after` times (configuration option, 0 disables tiering), it's
+ * recompiled with full optimizations in background, and the optimized
+ * library replaces the fast one.
+ *
+ * Loaded query libraries are kept in a cache bounded by `max_libraries`, and
+ * the least recently used ones are evicted. Evicted library is closed once
+ * the last generated function using it is released. Libraries that weren't
+ * used for `library_ttl` seconds are removed from disk on startup.
+ */
 class Compiler {
 public:
+  enum class Tier { FAST, OPTIMIZED };
+
   Compiler(const util::Config &config);
-  std::shared_ptr<SharedLibrary> Compile(const std::string &code);
+
+  /**
+   * Headers that are included by most of the generated code. They are
+   * precompiled at startup.
+   */
+  static const std::vector<std::string> &PrecompiledHeaders();
+
+  /**
+   * Compiles code with full optimizations, and waits for the compilation to
+   * complete. This is used for long living functions, like upsert.
+   *
+   * Code can be compiled against a module, which contains definitions shared
+   * by many libraries (like table structures). The module is written into a
+   * header, which is precompiled once, and is included into the code.
+   */
+  std::shared_ptr<SharedLibrary> Compile(const std::string &code,
+                                         const std::string &module = "");
+
+  /**
+   * Returns the best library compiled from this code so far, compiling it at
+   * the fast tier if there's no such library yet.
+   */
+  std::shared_ptr<SharedLibrary> CompileTiered(const std::string &code,
+                                               const std::string &module = "");
+
+  /**
+   * Returns compiled library if it's available already. Otherwise, schedules
+   * compilation in background, and returns nullptr.
+   */
+  std::shared_ptr<SharedLibrary> CompileAsync(const std::string &code,
+                                              const std::string &module = "");
+
+  /**
+   * @return hash identifying the library compiled from the given code (module
+   *         code followed by the code itself)
+   */
+  static uint64_t CodeHash(const std::string &code);
 
 private:
+  struct Entry {
+    std::shared_ptr<SharedLibrary> library;
+    Tier tier;
+    size_t executions;
+    bool pinned; // Long living functions are never evicted
+    std::list<uint64_t>::iterator lru_pos;
+  };
+
+  std::vector<Tier> Tiers() const;
+  Tier InitialTier(uint64_t code_hash) const;
+  std::string LibraryPrefix(uint64_t code_hash, Tier tier) const;
+  Entry &Install(uint64_t code_hash, std::shared_ptr<SharedLibrary> library,
+                 Tier tier, bool pinned);
+  void Touch(Entry &entry);
+  std::shared_ptr<SharedLibrary> Executed(uint64_t code_hash, Entry &entry,
+                                          const std::string &code,
+                                          const std::string &module);
+  std::shared_ptr<SharedLibrary> Load(const std::string &code,
+                                      const std::string &module,
+                                      uint64_t code_hash, Tier tier,
+                                      bool pinned);
+  void RemoveStaleLibraries(size_t ttl);
+  std::string WriteHeader(const std::string &name, const std::string &content);
+  void Precompile(const std::string &header, Tier tier);
+  std::shared_ptr<SharedLibrary> Build(const std::string &code,
+                                       const std::string &module,
+                                       uint64_t code_hash, Tier tier);
   std::vector<std::string> GetFunctionNames(const std::string &lib_file);
 
 private:
+  static const size_t BUILD_LOCKS = 16;
+
   std::vector<std::string> cmd_;
+  std::vector<std::string> fast_flags_;
+  std::vector<std::string> optimized_flags_;
+  std::vector<std::string> output_args_;
   std::string path_;
-  std::unordered_map<uint64_t, std::shared_ptr<SharedLibrary>> libs_;
+  std::string common_header_;
+  size_t optimize_after_;
+  size_t max_libraries_;
+  std::mutex build_mutexes_[BUILD_LOCKS];
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, Entry> libs_;
+  std::list<uint64_t> lru_;
+  std::unordered_map<std::string,
+                     std::shared_future<std::shared_ptr<SharedLibrary>>>
+      builds_;
+  std::unordered_set<uint64_t> pending_;
+  ThreadPool background_;
 };
 
 } // namespace codegen
@@ -32,8 +32,8 @@ Code TableMetadata::GenerateCode() const {
       {"db/table.h", "db/store.h", "db/dictionary.h", "nlohmann/json.hpp"});
   code.AddUsings({"json = nlohmann::json"});
 
-  StoreDefs store_defs(table_);
-  code << store_defs.GenerateCode();
+  TableModule table_module(table_);
+  code.UseModule(table_module.GenerateCode());
 
   code << "extern \"C\" void viya_table_metadata(db::Table& table, "
           "std::string& output) "
@@ -15,6 +15,7 @@
  */
 
 #include "codegen/db/store.h"
+#include "codegen/compiler.h"
 #include "codegen/db/rollup.h"
 #include "codegen/db/store.h"
 #include "db/column.h"
@@ -64,12 +65,13 @@ Code TupleStruct::GenerateCode() const {
   code << "   }\n";
   code << "  };\n";
 
-  // Hash generator functor:
+  // Hash generator functor, which mixes every field in, and finalizes the
+  // result, so that all bits of the hash value depend on all the fields:
   code << "  struct Hash {\n"
           "   std::size_t operator()(const Dimensions &k) const {\n"
           "    size_t h = 0L;\n";
   for (auto *dim : dimensions_) {
-    code << "    h ^= ";
+    code << "    h = (h ^ (size_t) ";
     if (dim->dim_type() == db::Dimension::DimType::NUMERIC &&
         static_cast<const db::NumDimension *>(dim)->fp()) {
       code << "std::hash<" << dim->num_type().cpp_type() << ">{} (k._"
@@ -77,9 +79,13 @@ Code TupleStruct::GenerateCode() const {
     } else {
       code << "k._" << std::to_string(dim->index());
     }
-    code << " + 0x9e3779b9 + (h<<6) + (h>>2);\n";
+    code << ") * 0x9e3779b97f4a7c15UL;\n"
+            "    h ^= h >> 32;\n";
   }
-  code << "    return h;\n"
+  code << "    h ^= h >> 29;\n"
+          "    h *= 0xbf58476d1ce4e5b9UL;\n"
+          "    h ^= h >> 32;\n"
+          "    return h;\n"
           "   }\n"
           "  };\n"
           " };\n";
@@ -202,7 +208,8 @@ Code SegmentStatsStruct::GenerateCode() const {
 
 Code StoreDefs::GenerateCode() const {
   Code code;
-  code.AddHeaders({"db/segment.h", "cstdio", "cstdint", "cstddef", "cfloat"});
+  code.AddHeaders(
+      {"db/segment.h", "cstdio", "cstdint", "cstddef", "cfloat", "vector"});
   code.AddNamespaces({"db = viya::db"});
 
   TupleStruct tuple_struct(table_.dimensions(), table_.metrics(), "Tuple");
@@ -351,10 +358,36 @@ Code StoreDefs::GenerateCode() const {
           "  lock_.unlock();\n"
           " }\n";
 
+  // Columns reflection function:
+  code << " std::vector<void*> columns() {\n"
+          "  return {";
+  for (auto *dim : table_.dimensions()) {
+    code << "(void*)d._" << std::to_string(dim->index()) << ",";
+  }
+  for (auto *metric : table_.metrics()) {
+    code << "(void*)m._" << std::to_string(metric->index()) << ",";
+  }
+  if (has_avg_metric && !has_count_metric) {
+    code << "(void*)m._count,";
+  }
+  code << "};\n"
+          " }\n";
+
   code << "};\n";
   return code;
 }
 
+Code TableModule::GenerateCode() const {
+  Code code;
+  code.AddHeaders(Compiler::PrecompiledHeaders());
+  code.AddNamespaces(
+      {"db = viya::db", "query = viya::query", "util = viya::util"});
+
+  StoreDefs store_defs(table_);
+  code << store_defs.GenerateCode();
+  return code;
+}
+
 bool UpsertContextDefs::AddOptimize() const {
   bool has_bitset_metric = std::any_of(
       table_.metrics().cbegin(), table_.metrics().cend(),
@@ -521,8 +554,8 @@ Code UpsertContextDefs::GenerateCode() const {
 Code StoreFunctions::GenerateCode() const {
   Code code;
 
-  StoreDefs store_defs(table_);
-  code << store_defs.GenerateCode();
+  TableModule table_module(table_);
+  code.UseModule(table_module.GenerateCode());
 
   UpsertContextDefs defs(table_);
   code << defs.GenerateCode();
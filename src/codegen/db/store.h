@@ -86,6 +86,22 @@ private:
   const db::Table &table_;
 };
 
+/**
+ * Table structures, which are shared by all the code generated for the table.
+ * This is compiled once into a precompiled header, instead of being parsed as
+ * a part of every query.
+ */
+class TableModule : public CodeGenerator {
+public:
+  TableModule(const db::Table &table) : table_(table) {}
+  DISALLOW_COPY_AND_MOVE(TableModule);
+
+  Code GenerateCode() const;
+
+private:
+  const db::Table &table_;
+};
+
 class UpsertContextDefs : public CodeGenerator {
 public:
   UpsertContextDefs(const db::Table &table) : table_(table) {}
@@ -40,28 +40,42 @@ void ValueParser::Visit(const db::StrDimension *dimension) {
     code_ << " }\n";
   }
 
-  code_ << " auto it = uctx->v2c" << dim_idx << "->find(value);\n";
-  code_ << " if (LIKELY(it != uctx->v2c" << dim_idx << "->end())) {\n";
+  // Dictionaries are shared by dimension name, so loaders of other tables may
+  // add values concurrently. The value is looked up under the shared lock
+  // first, and looked up again under the exclusive lock before a new code is
+  // assigned to it:
+  auto v2c = "uctx->v2c" + dim_idx;
+  auto dict = "uctx->dict" + dim_idx;
+  code_ << " " << dict << "->lock().lock_shared();\n";
+  code_ << " auto it = " << v2c << "->find(value);\n";
+  code_ << " bool found = it != " << v2c << "->end();\n";
+  code_ << " if (LIKELY(found)) {\n";
   code_ << "  upsert_tuple.d._" << dim_idx << " = it->second;\n";
-  code_ << " } else {\n";
-  code_ << "  uctx->dict" << dim_idx << "->lock().lock();\n";
-  code_ << "  auto code = uctx->dict" << dim_idx << "->c2v().size();\n";
+  code_ << " }\n";
+  code_ << " " << dict << "->lock().unlock_shared();\n";
+  code_ << " if (UNLIKELY(!found)) {\n";
+  code_ << "  " << dict << "->lock().lock();\n";
+  code_ << "  it = " << v2c << "->find(value);\n";
+  code_ << "  if (it != " << v2c << "->end()) {\n";
+  code_ << "   upsert_tuple.d._" << dim_idx << " = it->second;\n";
+  code_ << "  } else {\n";
+  code_ << "   auto code = " << dict << "->c2v().size();\n";
 
   auto cardinality = dimension->cardinality();
   bool check_cardinality = cardinality < UINT64_MAX - 1;
   if (check_cardinality) {
-    code_ << "  if(LIKELY(code <= " << cardinality << "U)) {\n";
+    code_ << "   if(LIKELY(code <= " << cardinality << "U)) {\n";
   }
-  code_ << "  upsert_tuple.d._" << dim_idx << " = code;\n";
-  code_ << "  uctx->v2c" << dim_idx << "->emplace(value, code);\n";
-  code_ << "  uctx->dict" << dim_idx << "->c2v().emplace_back(value);\n";
+  code_ << "   upsert_tuple.d._" << dim_idx << " = code;\n";
+  code_ << "   " << v2c << "->emplace(value, code);\n";
+  code_ << "   " << dict << "->c2v().emplace_back(value);\n";
   if (check_cardinality) {
-    code_ << "  } else {\n";
-    code_ << "   upsert_tuple.d._" << dim_idx << " = 0;\n";
-    code_ << "  }\n";
+    code_ << "   } else {\n";
+    code_ << "    upsert_tuple.d._" << dim_idx << " = 0;\n";
+    code_ << "   }\n";
   }
-
-  code_ << "  uctx->dict" << dim_idx << "->lock().unlock();\n";
+  code_ << "  }\n";
+  code_ << "  " << dict << "->lock().unlock();\n";
   code_ << " }\n";
 }
 
@@ -219,8 +233,8 @@ Code UpsertGenerator::SetupFunctionCode() const {
 
   code.AddNamespaces({"input = viya::input", "util = viya::util"});
 
-  StoreDefs store_defs(table);
-  code << store_defs.GenerateCode();
+  TableModule table_module(table);
+  code.UseModule(table_module.GenerateCode());
 
   UpsertContextDefs uc_defs(table);
   code << uc_defs.GenerateCode();
@@ -318,15 +332,11 @@ Code UpsertGenerator::PartitionFilter() const {
   Code code;
   if (desc_.has_partition_filter()) {
     auto &part_filter = desc_.partition_filter();
-    auto &tuple_idx_map = desc_.tuple_idx_map();
-    auto &table = desc_.table();
     code << "{\n";
     code << " uint32_t hash = 0;\n";
-    for (auto &key_col : part_filter.columns()) {
-      auto dim = table.dimension(key_col);
+    for (auto value_idx : desc_.partition_idx_map()) {
       code << " {\n";
-      code << "  auto& value = values[" << tuple_idx_map[dim->index()]
-           << "];\n";
+      code << "  auto& value = values[" << value_idx << "];\n";
       code << "  hash = util::crc32(hash, value);\n";
       code << " }\n";
     }
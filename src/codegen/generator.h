@@ -54,9 +54,20 @@ public:
     headers_.insert(c.headers_.begin(), c.headers_.end());
     namespaces_.insert(c.namespaces_.begin(), c.namespaces_.end());
     usings_.insert(c.usings_.begin(), c.usings_.end());
+    if (!c.module_.empty()) {
+      module_ = c.module_;
+    }
     return *this;
   }
 
+  /**
+   * Makes this code compile against the given module instead of containing
+   * its definitions (see Compiler::Compile())
+   */
+  void UseModule(const Code &module) { module_ = module.str(); }
+
+  const std::string &module() const { return module_; }
+
   std::string str() const;
 
 private:
@@ -64,6 +75,7 @@ private:
   std::unordered_set<std::string> headers_;
   std::unordered_set<std::string> namespaces_;
   std::unordered_set<std::string> usings_;
+  std::string module_;
 };
 
 class CodeGenerator {
@@ -80,13 +92,53 @@ public:
 
   virtual ~FunctionGenerator() {}
 
+  /**
+   * @return hash of the generated code, which identifies its library
+   */
+  uint64_t code_hash() {
+    Generate();
+    return Compiler::CodeHash(module_ + code_);
+  }
+
 protected:
   template <typename Func> Func GenerateFunction(const std::string &func_name) {
+    Generate();
+    library_ = compiler_.Compile(code_, module_);
+    return library_->GetFunction<Func>(func_name);
+  }
+
+  /**
+   * Same as GenerateFunction(), but the code is compiled with cheap
+   * optimizations first, and gets optimized once it's executed frequently.
+   */
+  template <typename Func>
+  Func GenerateTieredFunction(const std::string &func_name) {
+    Generate();
+    library_ = compiler_.CompileTiered(code_, module_);
+    return library_->GetFunction<Func>(func_name);
+  }
+
+  /**
+   * Same as GenerateFunction(), but doesn't wait for the compilation to
+   * complete: returns nullptr if the function is not available yet.
+   */
+  template <typename Func>
+  Func TryGenerateFunction(const std::string &func_name) {
+    Generate();
+    library_ = compiler_.CompileAsync(code_, module_);
+    if (library_ == nullptr) {
+      return nullptr;
+    }
+    return library_->GetFunction<Func>(func_name);
+  }
+
+private:
+  void Generate() {
     if (code_.empty()) {
-      code_ = GenerateCode().str();
+      auto code = GenerateCode();
+      code_ = code.str();
+      module_ = code.module();
     }
-    auto library = compiler_.Compile(code_);
-    return library->GetFunction<Func>(func_name);
   }
 
 protected:
@@ -94,6 +146,9 @@ protected:
 
 private:
   std::string code_;
+  std::string module_;
+  // Keeps the library loaded while generated function is in use:
+  std::shared_ptr<SharedLibrary> library_;
 };
 
 } // namespace codegen
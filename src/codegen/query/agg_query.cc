@@ -25,23 +25,32 @@ namespace codegen {
 
 Code AggQueryGenerator::GenerateCode() const {
   Code code;
-  code.AddHeaders({"unordered_map", "query/output.h", "query/stats.h",
+  code.AddHeaders({"algorithm", "atomic", "unordered_map", "vector",
+                   "query/batch_decoder.h", "query/cancel.h", "query/output.h",
+                   "query/parallel.h", "query/sample.h", "query/stats.h",
                    "db/table.h", "db/dictionary.h", "db/store.h",
-                   "util/format.h", "util/string.h"});
+                   "util/flat_map.h", "util/format.h", "util/string.h"});
 
   code.AddNamespaces(
       {"db = viya::db", "query = viya::query", "util = viya::util"});
 
+  TableModule table_module(query_.table());
+  code.UseModule(table_module.GenerateCode());
+
   code << "extern \"C\" void viya_query_agg(db::Table& table, "
           "query::RowOutput& output, query::QueryStats& stats,"
           "std::vector<db::AnyNum> fargs, size_t skip, size_t limit, "
-          "std::vector<db::AnyNum> hargs) "
+          "std::vector<db::AnyNum> hargs, "
+          "query::ParallelRunner& parallel, const query::Sample& sample, "
+          "const query::Cancellation& cancel) "
           "__attribute__((__visibility__(\"default\")));\n";
 
   code << "extern \"C\" void viya_query_agg(db::Table& table, "
           "query::RowOutput& output, query::QueryStats& stats,"
           "std::vector<db::AnyNum> fargs, size_t skip, size_t limit, "
-          "std::vector<db::AnyNum> hargs) {\n";
+          "std::vector<db::AnyNum> hargs, "
+          "query::ParallelRunner& parallel, const query::Sample& sample, "
+          "const query::Cancellation& cancel) {\n";
 
 #ifndef NDEBUG
   code << "\n// ========= definitions ==========\n";
@@ -57,9 +66,6 @@ Code AggQueryGenerator::GenerateCode() const {
   TupleStruct tuple_struct(dims, metrics, "AggTuple");
   code << tuple_struct.GenerateCode();
 
-  StoreDefs store_defs(query_.table());
-  code << store_defs.GenerateCode();
-
   ScanVisitor scan_visitor(code);
   query_.Accept(scan_visitor);
 
@@ -71,7 +77,13 @@ Code AggQueryGenerator::GenerateCode() const {
 }
 
 query::AggQueryFn AggQueryGenerator::Function() {
-  return GenerateFunction<query::AggQueryFn>(std::string("viya_query_agg"));
+  return GenerateTieredFunction<query::AggQueryFn>(
+      std::string("viya_query_agg"));
+}
+
+query::AggQueryFn AggQueryGenerator::TryFunction() {
+  return TryGenerateFunction<query::AggQueryFn>(
+      std::string("viya_query_agg"));
 }
 
 } // namespace codegen
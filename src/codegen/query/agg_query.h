@@ -36,6 +36,7 @@ public:
 
   Code GenerateCode() const;
   query::AggQueryFn Function();
+  query::AggQueryFn TryFunction();
 
 private:
   query::AggregateQuery &query_;
@@ -40,17 +40,75 @@ void PostAggVisitor::Visit(query::AggregateQuery *query) {
   }
 
   auto sort_columns = query->sort_cols();
+  auto cols = std::to_string(query->dimension_cols().size() +
+                             query->metric_cols().size());
   code_ << "typedef std::vector<std::string> Row;\n";
-  code_ << "Row row("
-        << std::to_string(query->dimension_cols().size() +
-                          query->metric_cols().size())
-        << ");\n";
+  code_ << "Row row(" << cols << ");\n";
   code_ << "util::Format fmt;\n";
 
+  // Records are materialized in batches. String dimensions of a batch are
+  // decoded at once:
+  code_ << "std::vector<Row> batch(query::DECODE_BATCH_SIZE, Row(" << cols
+        << "));\n"
+        << "size_t batch_rows = 0;\n"
+        << "query::RowOutput::RowView view(" << cols << ");\n";
+  for (auto &dim_col : query->dimension_cols()) {
+    auto dim = dim_col.dim();
+    if (dim->dim_type() == db::Dimension::DimType::STRING) {
+      code_ << "query::BatchDecoder<" << dim->num_type().cpp_type()
+            << "> decoder" << std::to_string(dim_col.index()) << "(dict"
+            << std::to_string(dim->index()) << ");\n";
+    }
+  }
+
   // Calculate how much records we should skip / drop:
   code_ << "skip = std::min(agg_map.size(), skip);\n";
   code_ << "limit = std::min(limit, agg_map.size() - skip);\n";
 
+  bool analyze = query->analyze();
+  if (TypedSort::Applicable(*query)) {
+    if (analyze) {
+      code_ << "stats.AddPlan(\"sort\", \"typed\");\n";
+    }
+
+    // Print header if requested:
+    HeaderGenerator header_gen(code_);
+    query->Accept(header_gen);
+
+    // Sort records, and materialize only those that are output:
+    TypedSort typed_sort(*query);
+    code_ << typed_sort.GenerateCode();
+
+    code_ << "if (cancel.cancelled()) return;\n";
+    if (analyze) {
+      code_ << "stats.StageEnd(\"sort\");\n";
+    }
+
+    OutputBatchFunction(query, true);
+    code_ << "auto sorted_end = limit > 0 ? std::min(sorted.size(), skip + "
+             "limit) : sorted.size();\n"
+             "for (size_t sorted_idx = skip; sorted_idx < sorted_end; "
+             "++sorted_idx) {\n"
+             " auto agg_it = sorted[sorted_idx];\n";
+    CheckCancelled("sorted_idx - skip");
+    AddToBatch(query);
+    code_ << " ++stats.output_recs;\n"
+             "}\n";
+    code_ << "if (cancel.cancelled()) return;\n";
+    code_ << "output_batch();\n";
+
+    code_ << "output.Flush();\n";
+    if (analyze) {
+      code_ << "stats.StageEnd(\"output\");\n";
+    }
+    return;
+  }
+
+  if (analyze) {
+    code_ << "stats.AddPlan(\"sort\", \""
+          << (sort_columns.empty() ? "none" : "rows") << "\");\n";
+  }
+
   code_ << "auto agg_it = agg_map.begin();\n";
   code_ << "auto agg_end = agg_map.end();\n";
   if (sort_columns.empty()) {
@@ -65,13 +123,16 @@ void PostAggVisitor::Visit(query::AggregateQuery *query) {
     // sorted:
     code_ << "std::vector<Row> post_agg;\n";
   }
+  OutputBatchFunction(query, sort_columns.empty());
 
   // Print header if requested:
   HeaderGenerator header_gen(code_);
   query->Accept(header_gen);
 
   // Iterate on agg_map, and materialize output records:
+  code_ << "size_t materialized = 0;\n";
   code_ << "for (; agg_it != agg_end; ++agg_it) {\n";
+  CheckCancelled("materialized++");
 
   // Apply HAVING filter:
   if (query->having() != nullptr) {
@@ -82,28 +143,104 @@ void PostAggVisitor::Visit(query::AggregateQuery *query) {
     code_ << " if (!r) continue;\n";
   }
 
+  AddToBatch(query);
+
+  // Records to sort are only counted when output:
+  if (sort_columns.empty()) {
+    code_ << " ++stats.output_recs;\n";
+  }
+  code_ << "}\n";
+  code_ << "if (cancel.cancelled()) return;\n";
+  code_ << "output_batch();\n";
+  if (analyze) {
+    code_ << "stats.StageEnd(\""
+          << (sort_columns.empty() ? "output" : "materialize") << "\");\n";
+  }
+
+  SortVisitor sort_visitor(code_);
+  query->Accept(sort_visitor);
+
+  code_ << "output.Flush();\n";
+}
+
+void PostAggVisitor::CheckCancelled(const std::string &row_counter) {
+  // Checking on every row is too expensive, since it reads the clock:
+  code_ << " if (((" << row_counter
+        << ") & 0xfff) == 0 && cancel.cancelled()) return;\n";
+}
+
+void PostAggVisitor::OutputBatchFunction(query::AggregateQuery *query,
+                                         bool send) {
+  code_ << "auto output_batch = [&]() {\n";
+  std::vector<std::string> decoders;
+  for (auto &dim_col : query->dimension_cols()) {
+    if (dim_col.dim()->dim_type() == db::Dimension::DimType::STRING) {
+      decoders.push_back("decoder" + std::to_string(dim_col.index()));
+    }
+  }
+  for (auto &decoder : decoders) {
+    code_ << " " << decoder << ".Decode();\n";
+  }
+
+  code_ << " for (size_t i = 0; i < batch_rows; ++i) {\n";
+  for (auto &dim_col : query->dimension_cols()) {
+    auto col_idx = std::to_string(dim_col.index());
+    if (dim_col.dim()->dim_type() == db::Dimension::DimType::STRING) {
+      code_ << "  view[" << col_idx << "] = decoder" << col_idx
+            << ".value(i);\n";
+    } else {
+      code_ << "  view[" << col_idx << "] = batch[i][" << col_idx << "];\n";
+    }
+  }
+  for (auto &metric_col : query->metric_cols()) {
+    auto col_idx = std::to_string(metric_col.index());
+    code_ << "  view[" << col_idx << "] = batch[i][" << col_idx << "];\n";
+  }
+  // Records that are sorted afterwards must keep their own copy of values:
+  if (send) {
+    code_ << "  output.SendView(view);\n";
+  } else {
+    code_ << "  post_agg.emplace_back(view.begin(), view.end());\n";
+  }
+  code_ << " }\n";
+
+  for (auto &decoder : decoders) {
+    code_ << " " << decoder << ".Clear();\n";
+  }
+  code_ << " batch_rows = 0;\n"
+           "};\n";
+}
+
+void PostAggVisitor::AddToBatch(query::AggregateQuery *query) {
+  code_ << " auto& batch_row = batch[batch_rows];\n";
+  MaterializeRow(query);
+  code_ << " if (++batch_rows == query::DECODE_BATCH_SIZE) {\n"
+           "  output_batch();\n"
+           " }\n";
+}
+
+void PostAggVisitor::MaterializeRow(query::AggregateQuery *query) {
   // Output dimensions:
   for (auto &dim_col : query->dimension_cols()) {
     auto dim = dim_col.dim();
     auto dim_idx = std::to_string(dim->index());
 
     if (dim->dim_type() == db::Dimension::DimType::STRING) {
-      code_ << "dict" << dim_idx << "->lock().lock_shared();\n";
-      code_ << "row[" << std::to_string(dim_col.index()) << "] = dict"
-            << dim_idx << "->c2v()[agg_it->first._" << dim_idx << "];\n";
-      code_ << " dict" << dim_idx << "->lock().unlock_shared();\n";
+      code_ << "decoder" << std::to_string(dim_col.index())
+            << ".Add(agg_it->first._" << dim_idx << ");\n";
 
     } else if (dim->dim_type() == db::Dimension::DimType::TIME &&
                !dim_col.format().empty()) {
-      code_ << "row[" << std::to_string(dim_col.index()) << "] = fmt.date(\""
-            << dim_col.format() << "\", agg_it->first._" << dim_idx << ");\n";
+      code_ << "batch_row[" << std::to_string(dim_col.index())
+            << "] = fmt.date(\"" << dim_col.format() << "\", agg_it->first._"
+            << dim_idx << ");\n";
 
     } else if (dim->dim_type() == db::Dimension::DimType::BOOLEAN) {
-      code_ << "row[" << std::to_string(dim_col.index())
+      code_ << "batch_row[" << std::to_string(dim_col.index())
             << "] = agg_it->first._" << dim_idx << "? \"true\" : \"false\";\n";
 
     } else {
-      code_ << "row[" << std::to_string(dim_col.index())
+      code_ << "batch_row[" << std::to_string(dim_col.index())
             << "] = fmt.num(agg_it->first._" << dim_idx << ");\n";
     }
   }
@@ -121,7 +258,7 @@ void PostAggVisitor::Visit(query::AggregateQuery *query) {
   for (auto &metric_col : query->metric_cols()) {
     auto metric = metric_col.metric();
     auto metric_idx = std::to_string(metric->index());
-    code_ << "row[" << std::to_string(metric_col.index()) << "]"
+    code_ << "batch_row[" << std::to_string(metric_col.index()) << "]"
           << " = fmt.num(agg_it->second._" << metric_idx;
     if (metric->agg_type() == db::Metric::AggregationType::AVG) {
       code_ << "/(double) agg_it->second._" << count_field;
@@ -130,20 +267,6 @@ void PostAggVisitor::Visit(query::AggregateQuery *query) {
     }
     code_ << ");\n";
   }
-
-  // Sort, optionally:
-  if (sort_columns.empty()) {
-    code_ << " output.Send(row);\n";
-    code_ << " ++stats.output_recs;\n";
-  } else {
-    code_ << " post_agg.push_back(row);\n";
-  }
-  code_ << "}\n";
-
-  SortVisitor sort_visitor(code_);
-  query->Accept(sort_visitor);
-
-  code_ << "output.Flush();\n";
 }
 
 void PostAggVisitor::Visit(query::SearchQuery *query) {
@@ -163,6 +286,9 @@ void PostAggVisitor::Visit(query::SearchQuery *query) {
   query->Accept(sort_visitor);
 
   code_ << "output.Flush();\n";
+  if (query->analyze()) {
+    code_ << "stats.StageEnd(\"output\");\n";
+  }
 }
 
 } // namespace codegen
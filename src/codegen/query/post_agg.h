@@ -32,6 +32,12 @@ public:
   void Visit(query::AggregateQuery *query) override;
   void Visit(query::SearchQuery *query) override;
 
+private:
+  void CheckCancelled(const std::string &row_counter);
+  void OutputBatchFunction(query::AggregateQuery *query, bool send);
+  void MaterializeRow(query::AggregateQuery *query);
+  void AddToBatch(query::AggregateQuery *query);
+
 private:
   Code &code_;
 };
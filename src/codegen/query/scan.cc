@@ -19,10 +19,84 @@
 #include "codegen/generator.h"
 #include "codegen/query/filter.h"
 #include "codegen/query/header.h"
+#include "db/table.h"
 
 namespace viya {
 namespace codegen {
 
+static const size_t SCAN_BLOCK_SIZE = 1024;
+static const size_t DENSE_AGG_MAX_SLOTS = 1 << 14;
+
+struct KeyDomain {
+  const db::Dimension *dim;
+  long min;
+  size_t size;
+};
+
+/**
+ * Finds value domains of all the grouping keys of the given query.
+ *
+ * @return whether an array indexed by key values can be used for aggregation
+ */
+static bool DenseKeyDomains(query::AggregateQuery *query,
+                            std::vector<KeyDomain> &domains) {
+  size_t slots_num = 1;
+  for (auto &dim_col : query->dimension_cols()) {
+    auto dim = dim_col.dim();
+    KeyDomain domain{dim, 0, 0};
+
+    switch (dim->dim_type()) {
+    case db::Dimension::DimType::BOOLEAN:
+      domain.size = 2;
+      break;
+    case db::Dimension::DimType::STRING: {
+      // Codes normally don't exceed the configured cardinality, since code 0
+      // is used for all the exceeding values. But a dictionary shared with a
+      // dimension of another table may hold larger codes, so they're checked
+      // during the scan:
+      auto cardinality =
+          static_cast<const db::StrDimension *>(dim)->cardinality();
+      if (cardinality < DENSE_AGG_MAX_SLOTS) {
+        domain.size = cardinality + 1;
+      }
+    } break;
+    case db::Dimension::DimType::NUMERIC:
+      switch (static_cast<const db::NumDimension *>(dim)->num_type().type()) {
+      case db::NumericType::BYTE:
+        domain.min = INT8_MIN;
+        domain.size = 1 << 8;
+        break;
+      case db::NumericType::UBYTE:
+        domain.size = 1 << 8;
+        break;
+      case db::NumericType::SHORT:
+        domain.min = INT16_MIN;
+        domain.size = 1 << 16;
+        break;
+      case db::NumericType::USHORT:
+        domain.size = 1 << 16;
+        break;
+      default:
+        break;
+      }
+      break;
+    default:
+      // Time buckets depend on the data, and can't be bounded in advance:
+      break;
+    }
+
+    if (domain.size == 0) {
+      return false;
+    }
+    slots_num *= domain.size;
+    if (slots_num > DENSE_AGG_MAX_SLOTS) {
+      return false;
+    }
+    domains.push_back(domain);
+  }
+  return true;
+}
+
 void ScanVisitor::UnpackArguments(query::FilterBasedQuery *query) {
   FilterArgsUnpack filter_args(query->table(), query->filter(), "farg");
   code_ << filter_args.GenerateCode();
@@ -39,34 +113,78 @@ void ScanVisitor::UnpackArguments(query::AggregateQuery *query) {
 
 void ScanVisitor::IterationStart(query::FilterBasedQuery *query) {
   // Iterate on segments:
-  code_ << "for (auto* s : table.store()->segments_copy()) {\n";
+  code_ << "auto segments = table.store()->segments_copy();\n"
+           "for (auto* s : segments) {\n";
+  SegmentStart(query, "stats.scanned_recs", "stats.scanned_segments");
+}
+
+void ScanVisitor::SegmentStart(query::FilterBasedQuery *query,
+                               const std::string &scanned_recs,
+                               const std::string &scanned_segments,
+                               const std::string &first_tuple) {
+  // Cancellation is checked before every segment, and before every block of
+  // tuples when they're filtered:
+  code_ << " if (cancel.cancelled()) break;\n";
   code_ << " auto segment_size = s->size();\n";
-  code_ << " stats.scanned_recs += segment_size;\n";
+  code_ << " " << scanned_recs << " += segment_size";
+  if (first_tuple != "0") {
+    code_ << " - " << first_tuple;
+  }
+  code_ << ";\n";
   code_ << " auto segment = static_cast<Segment*>(s);\n";
 
   // Check whether to skip this segment:
   SegmentSkip segment_skip(query->table(), query->filter());
   code_ << " auto process_segment = " << segment_skip.GenerateCode() << ";\n";
   code_ << " if (!process_segment) continue;\n";
-  code_ << " stats.scanned_segments++;\n";
+  code_ << " " << scanned_segments << "++;\n";
 
   code_ << " auto& tuple_dims = segment->d;\n";
   code_ << " auto& tuple_metrics = segment->m;\n";
 
-  // Iterate on tuples:
-  code_ << " for (size_t tuple_idx = 0; "
-           "tuple_idx < segment_size; ++tuple_idx) {\n";
+  if (dynamic_cast<const query::EmptyFilter *>(query->filter()) != nullptr) {
+    // Iterate on all tuples:
+    code_ << " for (size_t tuple_idx = " << first_tuple
+          << "; tuple_idx < segment_size; ++tuple_idx) {\n"
+             "  {\n";
+    return;
+  }
+
+  // Tuples are processed in blocks. First, the filter is evaluated for every
+  // tuple in a block into a mask, which the compiler can vectorize, since
+  // there are no branches. Then, indices of matching tuples are collected
+  // into a selection vector, again without branching:
+  auto block_size = std::to_string(SCAN_BLOCK_SIZE);
+  code_.AddHeaders({"algorithm", "cstdint"});
+  code_ << " for (size_t block_start = " << first_tuple
+        << "; block_start < segment_size; block_start += " << block_size
+        << ") {\n"
+        << "  if (cancel.cancelled()) break;\n"
+        << "  size_t block_size = std::min(segment_size - block_start, "
+           "(size_t) "
+        << block_size << ");\n"
+        << "  uint8_t mask[" << block_size << "];\n"
+        << "  size_t sel[" << block_size << "];\n";
 
-  // Apply filter, and check it's return code:
-  // TODO : is it possible to do it without IF branch?
   FilterComparison comparison(query->table(), query->filter(), "farg",
-                              "[tuple_idx]");
-  code_ << "  auto r = " << comparison.GenerateCode() << ";\n"
-        << "  if (r) {\n";
+                              "[block_start + i]");
+  code_ << "  for (size_t i = 0; i < block_size; ++i) {\n"
+        << "   mask[i] = " << comparison.GenerateCode() << ";\n"
+        << "  }\n";
+
+  code_ << "  size_t sel_size = 0;\n"
+           "  for (size_t i = 0; i < block_size; ++i) {\n"
+           "   sel[sel_size] = block_start + i;\n"
+           "   sel_size += mask[i];\n"
+           "  }\n";
+
+  // Iterate on selected tuples:
+  code_ << "  for (size_t sel_idx = 0; sel_idx < sel_size; ++sel_idx) {\n"
+           "   size_t tuple_idx = sel[sel_idx];\n";
 }
 
 void ScanVisitor::IterationEnd() {
-  // Close iteration loop:
+  // Close iteration loops:
   code_ << "  }\n"
            " }\n"
            "}\n";
@@ -88,22 +206,52 @@ void ScanVisitor::Visit(query::SelectQuery *query) {
     }
   }
 
+  auto cols = std::to_string(query->dimension_cols().size() +
+                             query->metric_cols().size());
   code_ << "typedef std::vector<std::string> Row;\n"
-        << "Row row("
-        << std::to_string(query->dimension_cols().size() +
-                          query->metric_cols().size())
-        << ");\n"
+        << "Row row(" << cols << ");\n"
         << "util::Format fmt;\n"
-        << "size_t row_index = 0;\n"
-        << "output.Start();\n";
+        << "size_t row_index = 0;\n";
+
+  // Rows are output in batches. String dimensions of a batch are decoded at
+  // once, before the batch is output:
+  code_ << "std::vector<Row> batch(query::DECODE_BATCH_SIZE, Row(" << cols
+        << "));\n"
+        << "size_t batch_rows = 0;\n"
+        << "query::RowOutput::RowView view(" << cols << ");\n";
+  for (auto &dim_col : query->dimension_cols()) {
+    auto dim = dim_col.dim();
+    if (dim->dim_type() == db::Dimension::DimType::STRING) {
+      code_ << "query::BatchDecoder<" << dim->num_type().cpp_type()
+            << "> decoder" << std::to_string(dim_col.index()) << "(dict"
+            << std::to_string(dim->index()) << ");\n";
+    }
+  }
+  OutputBatchFunction(query);
+
+  code_ << "output.Start();\n";
 
   // Print header if requested:
   HeaderGenerator header_gen(code_);
   query->Accept(header_gen);
 
-  IterationStart(query);
+  // Paginated scan starts from the cursor position:
+  bool paginated = query->cursor().enabled();
+  if (paginated) {
+    code_ << "auto segments = table.store()->segments_copy();\n"
+             "for (size_t segment_idx = cursor.segment(); "
+             "segment_idx < segments.size(); ++segment_idx) {\n"
+             " auto* s = segments[segment_idx];\n"
+             " size_t first_tuple = "
+             "segment_idx == cursor.segment() ? cursor.tuple() : 0;\n";
+    SegmentStart(query, "stats.scanned_recs", "stats.scanned_segments",
+                 "first_tuple");
+  } else {
+    IterationStart(query);
+  }
 
   code_ << "if (skip > 0 && row_index++ < skip) continue;\n";
+  code_ << "auto& batch_row = batch[batch_rows];\n";
 
   // Output dimensions:
   for (auto &dim_col : query->dimension_cols()) {
@@ -111,23 +259,22 @@ void ScanVisitor::Visit(query::SelectQuery *query) {
     auto dim_idx = std::to_string(dim->index());
 
     if (dim->dim_type() == db::Dimension::DimType::STRING) {
-      code_ << " dict" << dim_idx << "->lock().lock_shared();\n"
-            << " row[" << std::to_string(dim_col.index()) << "] = dict"
-            << dim_idx << "->c2v()[tuple_dims._" << dim_idx << "[tuple_idx]];\n"
-            << " dict" << dim_idx << "->lock().unlock_shared();\n";
+      code_ << " decoder" << std::to_string(dim_col.index())
+            << ".Add(tuple_dims._" << dim_idx << "[tuple_idx]);\n";
 
     } else if (dim->dim_type() == db::Dimension::DimType::TIME &&
                !dim_col.format().empty()) {
-      code_ << " row[" << std::to_string(dim_col.index()) << "] = fmt.date(\""
-            << dim_col.format() << "\", tuple_dims._" << dim_idx
-            << "[tuple_idx]);\n";
+      code_ << " batch_row[" << std::to_string(dim_col.index())
+            << "] = fmt.date(\"" << dim_col.format() << "\", tuple_dims._"
+            << dim_idx << "[tuple_idx]);\n";
 
     } else if (dim->dim_type() == db::Dimension::DimType::BOOLEAN) {
-      code_ << " row[" << std::to_string(dim_col.index()) << "] = tuple_dims._"
-            << dim_idx << "[tuple_idx] ? \"true\" : \"false\";\n";
+      code_ << " batch_row[" << std::to_string(dim_col.index())
+            << "] = tuple_dims._" << dim_idx
+            << "[tuple_idx] ? \"true\" : \"false\";\n";
 
     } else {
-      code_ << " row[" << std::to_string(dim_col.index())
+      code_ << " batch_row[" << std::to_string(dim_col.index())
             << "] = fmt.num(tuple_dims._" << dim_idx << "[tuple_idx]);\n";
     }
   }
@@ -145,7 +292,7 @@ void ScanVisitor::Visit(query::SelectQuery *query) {
   for (auto &metric_col : query->metric_cols()) {
     auto metric = metric_col.metric();
     auto metric_idx = std::to_string(metric->index());
-    code_ << "row[" << std::to_string(metric_col.index())
+    code_ << "batch_row[" << std::to_string(metric_col.index())
           << "] = fmt.num(tuple_metrics._" << metric_idx << "[tuple_idx]";
     if (metric->agg_type() == db::Metric::AggregationType::AVG) {
       code_ << "/(double) tuple_metrics._" << count_field << "[tuple_idx]";
@@ -155,14 +302,31 @@ void ScanVisitor::Visit(query::SelectQuery *query) {
     code_ << ");\n";
   }
 
-  code_ << " output.Send(row);\n";
   code_ << " ++stats.output_recs;\n";
-
-  code_ << " if (limit > 0 && stats.output_recs >= limit) break;\n";
+  code_ << " if (++batch_rows == query::DECODE_BATCH_SIZE) {\n"
+           "  output_batch();\n"
+           " }\n";
+
+  // Limit applies to the whole scan, and not only to the current segment:
+  code_ << " if (limit > 0 && stats.output_recs >= limit) {\n";
+  if (paginated) {
+    code_ << "  cursor.Stop(segment_idx, tuple_idx + 1);\n";
+  }
+  code_ << "  goto scan_done;\n"
+           " }\n";
 
   IterationEnd();
+  code_ << "scan_done:;\n";
+  code_ << "if (cancel.cancelled()) return;\n";
+  code_ << "output_batch();\n";
 
   code_ << "output.Flush();\n";
+
+  // Rows are output while scanning, so it's a single stage:
+  if (query->analyze()) {
+    code_ << "stats.StageEnd(\"scan\");\n";
+    AddSegmentsPlan();
+  }
 }
 
 void ScanVisitor::Visit(query::AggregateQuery *query) {
@@ -171,13 +335,86 @@ void ScanVisitor::Visit(query::AggregateQuery *query) {
 #endif
 
   // Structures for aggragation in memory:
-  code_ << "AggTuple agg_tuple;\n"
-           "std::unordered_map<AggTuple::Dimensions,"
+  code_ << "typedef util::FlatHashMap<AggTuple::Dimensions,"
            "AggTuple::Metrics,AggTuple::Dimensions::Hash,"
-           "AggTuple::Dimensions::KeyEqual> agg_map;\n";
+           "AggTuple::Dimensions::KeyEqual> AggMap;\n";
 
   UnpackArguments(query);
 
+  // When all the grouping keys have small value domains, aggregate into an
+  // array indexed by a mixed-radix combination of key values:
+  std::vector<KeyDomain> domains;
+  bool dense = DenseKeyDomains(query, domains);
+  size_t slots_num = 1;
+  for (auto &domain : domains) {
+    slots_num *= domain.size;
+  }
+
+  // Metrics whose totals are estimated from a sample of segments:
+  bool sample = query->sample().enabled();
+  std::vector<const db::Metric *> sampled_metrics;
+  if (sample) {
+    for (auto &metric_col : query->metric_cols()) {
+      auto agg_type = metric_col.metric()->agg_type();
+      if (agg_type == db::Metric::AggregationType::SUM ||
+          agg_type == db::Metric::AggregationType::COUNT) {
+        sampled_metrics.push_back(metric_col.metric());
+      }
+    }
+  }
+
+  // Segments are handed out to workers one at a time, and every worker
+  // aggregates into its own map:
+  code_ << "auto segments = table.store()->segments_copy();\n";
+  if (sample) {
+    code_ << "double sample_scale = sample.Select(segments);\n"
+             "std::vector<std::vector<double>> segment_totals("
+          << std::to_string(sampled_metrics.size())
+          << ", std::vector<double>(segments.size(), 0.0));\n";
+  }
+  code_ << "size_t workers = std::max(std::min(parallel.parallelism(), "
+           "segments.size()), (size_t) 1);\n"
+           "std::atomic<size_t> next_segment(0);\n"
+           "std::vector<size_t> scanned_recs(workers, 0);\n"
+           "std::vector<size_t> scanned_segments(workers, 0);\n";
+
+  if (dense) {
+    code_ << "std::vector<std::vector<AggTuple::Metrics>> agg_slots(workers, "
+             "std::vector<AggTuple::Metrics>("
+          << std::to_string(slots_num) << "));\n"
+          << "std::vector<std::vector<uint8_t>> agg_used(workers, "
+             "std::vector<uint8_t>("
+          << std::to_string(slots_num) << ", 0));\n"
+          << "std::vector<AggMap> agg_overflow(workers);\n";
+  } else {
+    // Number of groups aggregated by the previous run of this query is used
+    // for sizing the maps up front, where every worker gets its share:
+    code_ << "static std::atomic<size_t> expected_groups(0);\n"
+             "size_t agg_map_size = (expected_groups.load() + workers - 1) / "
+             "workers;\n"
+             "std::vector<AggMap> agg_maps(workers);\n";
+  }
+
+  bool analyze = query->analyze();
+  if (analyze) {
+    code_.AddHeaders({"chrono"});
+    code_ << "std::vector<std::chrono::duration<float>> worker_cpu(workers);\n";
+  }
+
+  code_ << "auto scan = [&](size_t worker) {\n"
+           "AggTuple agg_tuple;\n";
+  if (analyze) {
+    code_ << "auto cpu_begin = query::QueryStats::ThreadCpuTime();\n";
+  }
+  if (dense) {
+    code_ << "auto& slots = agg_slots[worker];\n"
+             "auto& used = agg_used[worker];\n"
+             "auto& overflow = agg_overflow[worker];\n";
+  } else {
+    code_ << "auto& agg_map = agg_maps[worker];\n"
+             "agg_map.reserve(agg_map_size);\n";
+  }
+
   std::vector<const db::Dimension *> dims;
   for (auto &dim_col : query->dimension_cols()) {
     dims.push_back(dim_col.dim());
@@ -188,38 +425,69 @@ void ScanVisitor::Visit(query::AggregateQuery *query) {
   RollupReset rollup_reset(dims);
   code_ << rollup_reset.GenerateCode();
 
-  IterationStart(query);
-
-  for (auto &dim_col : query->dimension_cols()) {
-    auto dimension = dim_col.dim();
-    auto dim_idx = std::to_string(dimension->index());
-
-    bool time_rollup = false;
-    if (dimension->dim_type() == db::Dimension::DimType::TIME) {
-      auto time_dim = static_cast<const db::TimeDimension *>(dimension);
-
-      if (!time_dim->rollup_rules().empty() || !dim_col.granularity().empty()) {
-        time_rollup = true;
-
-        code_ << "time" << dim_idx << ".set_ts(tuple_dims._" << dim_idx
-              << "[tuple_idx]);\n";
-
-        TimestampRollup ts_rollup(time_dim,
-                                  "tuple_dims._" + dim_idx + "[tuple_idx]");
-        code_ << ts_rollup.GenerateCode();
+  code_ << "for (size_t seg_idx; "
+           "(seg_idx = next_segment++) < segments.size();) {\n"
+           " auto* s = segments[seg_idx];\n";
+  SegmentStart(query, "scanned_recs[worker]", "scanned_segments[worker]");
+
+  // Keys with string codes outside of their domain are aggregated into an
+  // overflow map:
+  std::string in_domain;
+  for (auto &domain : domains) {
+    if (domain.dim->dim_type() == db::Dimension::DimType::STRING) {
+      if (!in_domain.empty()) {
+        in_domain += " && ";
+      }
+      in_domain += "(size_t) tuple_dims._" +
+                   std::to_string(domain.dim->index()) + "[tuple_idx] < " +
+                   std::to_string(domain.size);
+    }
+  }
 
-        if (!dim_col.granularity().empty()) {
-          code_ << "time" << dim_idx << ".trunc<static_cast<util::TimeUnit>("
-                << static_cast<int>(dim_col.granularity().time_unit())
-                << ")>();\n";
-        }
-        code_ << "   agg_tuple.d._" << dim_idx << " = time" << dim_idx
-              << ".get_ts();\n";
+  if (dense) {
+    code_ << "   size_t slot = 0;\n";
+    for (auto &domain : domains) {
+      code_ << "   slot = slot * " << std::to_string(domain.size)
+            << " + (size_t) (tuple_dims._"
+            << std::to_string(domain.dim->index()) << "[tuple_idx]";
+      if (domain.min != 0) {
+        code_ << " - (" << std::to_string(domain.min) << ")";
       }
+      code_ << ");\n";
     }
-    if (!time_rollup) {
-      code_ << "   agg_tuple.d._" << dim_idx << " = tuple_dims._" << dim_idx
-            << "[tuple_idx];\n";
+  } else {
+    for (auto &dim_col : query->dimension_cols()) {
+      auto dimension = dim_col.dim();
+      auto dim_idx = std::to_string(dimension->index());
+
+      bool time_rollup = false;
+      if (dimension->dim_type() == db::Dimension::DimType::TIME) {
+        auto time_dim = static_cast<const db::TimeDimension *>(dimension);
+
+        if (!time_dim->rollup_rules().empty() ||
+            !dim_col.granularity().empty()) {
+          time_rollup = true;
+
+          code_ << "time" << dim_idx << ".set_ts(tuple_dims._" << dim_idx
+                << "[tuple_idx]);\n";
+
+          TimestampRollup ts_rollup(time_dim,
+                                    "tuple_dims._" + dim_idx + "[tuple_idx]");
+          code_ << ts_rollup.GenerateCode();
+
+          if (!dim_col.granularity().empty()) {
+            code_ << "time" << dim_idx << ".trunc<static_cast<util::TimeUnit>("
+                  << static_cast<int>(dim_col.granularity().time_unit())
+                  << ")>();\n";
+          }
+          code_ << "   agg_tuple.d._" << dim_idx << " = time" << dim_idx
+                << ".get_ts();\n";
+        }
+      }
+      if (!time_rollup) {
+        code_ << "   agg_tuple.d._" << dim_idx << " = tuple_dims._" << dim_idx
+              << "[tuple_idx];\n";
+      }
     }
   }
 
@@ -239,11 +507,317 @@ void ScanVisitor::Visit(query::AggregateQuery *query) {
   if (has_avg_metric && !has_count_metric) {
     code_ << "   agg_tuple.m._count = tuple_metrics._count[tuple_idx];\n";
   }
-  code_ << "   agg_map[agg_tuple.d].Update(agg_tuple.m);\n";
+  for (size_t i = 0; i < sampled_metrics.size(); ++i) {
+    code_ << "   segment_totals[" << std::to_string(i)
+          << "][seg_idx] += tuple_metrics._"
+          << std::to_string(sampled_metrics[i]->index()) << "[tuple_idx];\n";
+  }
+  if (dense && !in_domain.empty()) {
+    code_ << "   if (" << in_domain << ") {\n"
+          << "    slots[slot].Update(agg_tuple.m);\n"
+             "    used[slot] = 1;\n"
+             "   } else {\n";
+    for (auto &domain : domains) {
+      auto dim_idx = std::to_string(domain.dim->index());
+      code_ << "    agg_tuple.d._" << dim_idx << " = tuple_dims._" << dim_idx
+            << "[tuple_idx];\n";
+    }
+    code_ << "    overflow[agg_tuple.d].Update(agg_tuple.m);\n"
+             "   }\n";
+  } else if (dense) {
+    code_ << "   slots[slot].Update(agg_tuple.m);\n"
+             "   used[slot] = 1;\n";
+  } else {
+    code_ << "   agg_map[agg_tuple.d].Update(agg_tuple.m);\n";
+  }
 
   IterationEnd();
+  if (analyze) {
+    code_ << "worker_cpu[worker] = "
+             "query::QueryStats::ThreadCpuTime() - cpu_begin;\n";
+  }
+  code_ << "};\n";
+
+  code_ << "if (workers > 1) {\n"
+           " parallel.Run(workers, scan);\n"
+           "} else {\n"
+           " scan(0);\n"
+           "}\n";
+
+  // The first worker runs on the calling thread, so CPU time of the others
+  // is added to the stage:
+  if (analyze) {
+    code_ << "std::chrono::duration<float> workers_cpu(0);\n"
+             "for (size_t w = 1; w < workers; ++w) {\n"
+             " workers_cpu += worker_cpu[w];\n"
+             "}\n"
+             "stats.StageEnd(\"scan\", workers_cpu);\n";
+  }
+
+  if (dense) {
+    // Merge all the slots into the first worker's array, and then convert
+    // used slots back to grouping keys:
+    code_ << "auto& slots = agg_slots[0];\n"
+             "auto& used = agg_used[0];\n"
+             "for (size_t w = 1; w < workers; ++w) {\n"
+             " for (size_t slot = 0; slot < "
+          << std::to_string(slots_num) << "; ++slot) {\n"
+          << "  if (agg_used[w][slot]) {\n"
+             "   slots[slot].Update(agg_slots[w][slot]);\n"
+             "   used[slot] = 1;\n"
+             "  }\n"
+             " }\n"
+             "}\n"
+             "AggMap agg_map;\n"
+             "AggTuple::Dimensions key;\n"
+             "for (size_t slot = 0; slot < "
+          << std::to_string(slots_num) << "; ++slot) {\n"
+          << " if (used[slot]) {\n"
+             "  size_t rest = slot;\n";
+    for (auto it = domains.rbegin(); it != domains.rend(); ++it) {
+      auto dim_idx = std::to_string(it->dim->index());
+      auto size = std::to_string(it->size);
+      code_ << "  key._" << dim_idx << " = static_cast<"
+            << it->dim->num_type().cpp_type() << ">(";
+      if (it->min != 0) {
+        code_ << "(long) (rest % " << size << ") + ("
+              << std::to_string(it->min) << ")";
+      } else {
+        code_ << "rest % " << size;
+      }
+      code_ << ");\n"
+            << "  rest /= " << size << ";\n";
+    }
+    code_ << "  agg_map.emplace(key, slots[slot]);\n"
+             " }\n"
+             "}\n"
+             "for (auto& overflow : agg_overflow) {\n"
+             " for (auto& it : overflow) {\n"
+             "  agg_map[it.first].Update(it.second);\n"
+             " }\n"
+             "}\n";
+  } else {
+    // Merge all the maps into the largest one:
+    code_ << "for (size_t w = 1; w < workers; ++w) {\n"
+             " if (agg_maps[w].size() > agg_maps[0].size()) {\n"
+             "  agg_maps[0].swap(agg_maps[w]);\n"
+             " }\n"
+             "}\n"
+             "auto& agg_map = agg_maps[0];\n"
+             "for (size_t w = 1; w < workers; ++w) {\n"
+             " for (auto& it : agg_maps[w]) {\n"
+             "  agg_map[it.first].Update(it.second);\n"
+             " }\n"
+             " AggMap().swap(agg_maps[w]);\n"
+             "}\n"
+             "expected_groups = agg_map.size();\n";
+  }
+
+  code_ << "for (size_t w = 0; w < workers; ++w) {\n"
+           " stats.scanned_recs += scanned_recs[w];\n"
+           " stats.scanned_segments += scanned_segments[w];\n"
+           "}\n";
+
+  code_ << "if (cancel.cancelled()) {\n"
+           " stats.aggregated_recs = agg_map.size();\n"
+           " return;\n"
+           "}\n";
+
+  if (sample) {
+    // Scale additive metrics up to estimates over the whole table. Averages
+    // are scaled together with the count they're divided by:
+    code_ << "for (auto& it : agg_map) {\n";
+    for (auto &metric_col : query->metric_cols()) {
+      auto metric = metric_col.metric();
+      auto agg_type = metric->agg_type();
+      if (agg_type != db::Metric::AggregationType::SUM &&
+          agg_type != db::Metric::AggregationType::COUNT &&
+          agg_type != db::Metric::AggregationType::AVG) {
+        continue;
+      }
+      auto field = "it.second._" + std::to_string(metric->index());
+      if (static_cast<const db::ValueMetric *>(metric)->fp()) {
+        code_ << " " << field << " *= sample_scale;\n";
+      } else {
+        code_ << " " << field << " = std::llround(" << field
+              << " * sample_scale);\n";
+      }
+    }
+    if (has_avg_metric && !has_count_metric) {
+      code_ << " it.second._count = "
+               "std::llround(it.second._count * sample_scale);\n";
+    }
+    code_ << "}\n";
+
+    code_.AddHeaders({"cmath", "string"});
+    code_ << "output.AddHeader(\"X-Sample-Fraction\", "
+             "std::to_string(1.0 / sample_scale));\n";
+    for (size_t i = 0; i < sampled_metrics.size(); ++i) {
+      code_ << "output.AddHeader(\"X-Sample-Error-"
+            << sampled_metrics[i]->name()
+            << "\", std::to_string(query::Sample::RelativeError("
+               "segment_totals["
+            << std::to_string(i) << "], sample_scale)));\n";
+    }
+  }
 
   code_ << "stats.aggregated_recs = agg_map.size();\n";
+
+  if (analyze) {
+    code_ << "stats.StageEnd(\"merge\");\n";
+    code_ << "stats.AddPlan(\"aggregation\", \""
+          << (dense ? "dense, " + std::to_string(slots_num) + " slots"
+                    : std::string("hash map"))
+          << "\");\n";
+    code_ << "stats.AddPlan(\"workers\", std::to_string(workers));\n";
+    if (sample) {
+      code_ << "stats.AddPlan(\"sample_fraction\", "
+               "std::to_string(1.0 / sample_scale));\n";
+    }
+    AddSegmentsPlan();
+  }
+}
+
+void ScanVisitor::SearchDictionary(query::SearchQuery *query) {
+  auto dim = query->dimension();
+  auto dim_idx = std::to_string(dim->index());
+
+  // Possible values of a string dimension are exactly its dictionary values,
+  // so the term is checked against every value once. Codes of matching
+  // values are marked in a flags vector indexed by code:
+  code_.AddHeaders({"cstdint", "vector"});
+  code_ << "auto dict" << dim_idx
+        << " = static_cast<const db::StrDimension*>(table.dimension("
+        << dim_idx << "))->dict();\n"
+        << "std::vector<std::string> values;\n"
+        << "std::vector<uint8_t> candidates;\n"
+        << "size_t candidates_num = 0;\n"
+        << "dict" << dim_idx << "->lock().lock_shared();\n"
+        << "auto& c2v = dict" << dim_idx << "->c2v();\n"
+        << "candidates.resize(c2v.size());\n"
+        << "for (size_t code = 0; code < c2v.size(); ++code) {\n"
+        << " if (c2v[code].find(term) != std::string::npos) {\n"
+        << "  candidates[code] = 1;\n"
+        << "  ++candidates_num;\n"
+        << " }\n"
+        << "}\n";
+
+  // Segments are only scanned when some dictionary values may be absent
+  // from the result: when they're filtered out, when the dictionary holds
+  // values of other tables, when the value standing for exceeded cardinality
+  // matches, or when a cardinality guard may have replaced stored values:
+  bool filtered =
+      dynamic_cast<const query::EmptyFilter *>(query->filter()) == nullptr;
+  bool guarded = false;
+  for (auto &guard : query->table().cardinality_guards()) {
+    if (guard.dim() == dim) {
+      guarded = true;
+    }
+  }
+  code_ << "bool scan = candidates_num > 0 && ("
+        << (filtered || guarded
+                ? "true"
+                : "dict" + dim_idx + "->shared() || candidates[0] != 0")
+        << ");\n";
+
+  code_ << "if (!scan) {\n"
+           " for (size_t code = 0; code < candidates.size(); ++code) {\n"
+           "  if (candidates[code] != 0) {\n"
+           "   values.push_back(c2v[code]);\n"
+           "   if (limit > 0 && values.size() >= limit) break;\n"
+           "  }\n"
+           " }\n"
+           "}\n";
+  code_ << "dict" << dim_idx << "->lock().unlock_shared();\n";
+
+  if (query->analyze()) {
+    code_ << "stats.AddPlan(\"search\", "
+             "scan ? \"dictionary, segments scan\" : \"dictionary\");\n";
+  }
+
+  UnpackArguments(query);
+
+  // Scan only resolves which of the matching codes appear in tuples that
+  // pass the filter. Once all of them are found, the scan stops:
+  code_ << "std::vector<" << dim->num_type().cpp_type() << "> found;\n"
+        << "std::vector<db::SegmentBase*> segments;\n"
+        << "if (scan) {\n"
+        << " segments = table.store()->segments_copy();\n"
+        << "}\n"
+        << "for (auto* s : segments) {\n";
+  SegmentStart(query, "stats.scanned_recs", "stats.scanned_segments");
+
+  code_ << "auto tuple_code = tuple_dims._" << dim_idx << "[tuple_idx];\n"
+        << "if (tuple_code < candidates.size() && "
+           "candidates[tuple_code] == 1) {\n"
+        << " candidates[tuple_code] = 2;\n"
+        << " found.push_back(tuple_code);\n"
+        << " if (found.size() == candidates_num ||\n"
+        << "     (limit > 0 && found.size() >= limit)) goto scan_done;\n"
+        << "}\n";
+
+  IterationEnd();
+  code_ << "scan_done:;\n";
+
+  // Found values are decoded all at once:
+  code_ << "if (!found.empty()) {\n"
+        << " dict" << dim_idx << "->lock().lock_shared();\n"
+        << " for (auto code : found) {\n"
+        << "  values.push_back(c2v[code]);\n"
+        << " }\n"
+        << " dict" << dim_idx << "->lock().unlock_shared();\n"
+        << "}\n";
+
+  code_ << "stats.aggregated_recs = candidates_num;\n";
+  code_ << "if (cancel.cancelled()) return;\n";
+
+  if (query->analyze()) {
+    code_ << "stats.StageEnd(\"scan\");\n";
+    AddSegmentsPlan();
+  }
+}
+
+void ScanVisitor::OutputBatchFunction(query::SelectQuery *query) {
+  code_ << "auto output_batch = [&]() {\n";
+  std::vector<std::string> decoders;
+  for (auto &dim_col : query->dimension_cols()) {
+    if (dim_col.dim()->dim_type() == db::Dimension::DimType::STRING) {
+      decoders.push_back("decoder" + std::to_string(dim_col.index()));
+    }
+  }
+  for (auto &decoder : decoders) {
+    code_ << " " << decoder << ".Decode();\n";
+  }
+
+  code_ << " for (size_t i = 0; i < batch_rows; ++i) {\n";
+  for (auto &dim_col : query->dimension_cols()) {
+    auto col_idx = std::to_string(dim_col.index());
+    if (dim_col.dim()->dim_type() == db::Dimension::DimType::STRING) {
+      code_ << "  view[" << col_idx << "] = decoder" << col_idx
+            << ".value(i);\n";
+    } else {
+      code_ << "  view[" << col_idx << "] = batch[i][" << col_idx << "];\n";
+    }
+  }
+  for (auto &metric_col : query->metric_cols()) {
+    auto col_idx = std::to_string(metric_col.index());
+    code_ << "  view[" << col_idx << "] = batch[i][" << col_idx << "];\n";
+  }
+  code_ << "  output.SendView(view);\n"
+           " }\n";
+
+  for (auto &decoder : decoders) {
+    code_ << " " << decoder << ".Clear();\n";
+  }
+  code_ << " batch_rows = 0;\n"
+           "};\n";
+}
+
+void ScanVisitor::AddSegmentsPlan() {
+  code_.AddHeaders({"string"});
+  code_ << "stats.AddPlan(\"segments\", std::to_string(segments.size()));\n"
+           "stats.AddPlan(\"skipped_segments\", "
+           "std::to_string(segments.size() - stats.scanned_segments));\n";
 }
 
 void ScanVisitor::Visit(query::SearchQuery *query) {
@@ -253,16 +827,14 @@ void ScanVisitor::Visit(query::SearchQuery *query) {
   auto dim = query->dimension();
   auto dim_idx = std::to_string(dim->index());
 
-  code_ << "std::unordered_set<" << dim->num_type().cpp_type() << "> codes;\n";
-  code_ << "std::vector<std::string> values;\n";
-  code_ << "std::string check_value;\n";
-
   if (dim->dim_type() == db::Dimension::DimType::STRING) {
-    code_ << "auto dict" << dim_idx
-          << " = static_cast<const db::StrDimension*>(table.dimension("
-          << dim_idx << "))->dict();\n";
+    SearchDictionary(query);
+    return;
   }
 
+  code_ << "std::unordered_set<" << dim->num_type().cpp_type() << "> codes;\n";
+  code_ << "std::vector<std::string> values;\n";
+  code_ << "std::string check_value;\n";
   code_ << "util::Format fmt;\n";
 
   UnpackArguments(query);
@@ -272,13 +844,7 @@ void ScanVisitor::Visit(query::SearchQuery *query) {
   code_ << "if (codes.insert(tuple_dims._" << dim_idx
         << "[tuple_idx]).second) {\n";
 
-  if (dim->dim_type() == db::Dimension::DimType::STRING) {
-    code_ << "dict" << dim_idx << "->lock().lock_shared();\n";
-    code_ << "check_value = dict" << dim_idx << "->c2v()[tuple_dims._"
-          << dim_idx << "[tuple_idx]];\n";
-    code_ << " dict" << dim_idx << "->lock().unlock_shared();\n";
-
-  } else if (dim->dim_type() == db::Dimension::DimType::BOOLEAN) {
+  if (dim->dim_type() == db::Dimension::DimType::BOOLEAN) {
     code_ << "check_value = tuple_dims._" << dim_idx
           << "[tuple_idx] ? \"true\" : \"false\";\n";
 
@@ -289,13 +855,20 @@ void ScanVisitor::Visit(query::SearchQuery *query) {
 
   code_ << " if (check_value.find(term) != std::string::npos) {\n";
   code_ << "   values.push_back(check_value);\n";
-  code_ << "   if (limit > 0 && values.size() >= limit) break;\n";
+  code_ << "   if (limit > 0 && values.size() >= limit) goto scan_done;\n";
   code_ << " }\n";
   code_ << "}\n";
 
   IterationEnd();
+  code_ << "scan_done:;\n";
 
   code_ << "stats.aggregated_recs = codes.size();\n";
+  code_ << "if (cancel.cancelled()) return;\n";
+
+  if (query->analyze()) {
+    code_ << "stats.StageEnd(\"scan\");\n";
+    AddSegmentsPlan();
+  }
 }
 
 } // namespace codegen
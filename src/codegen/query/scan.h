@@ -18,6 +18,7 @@
 #define VIYA_CODEGEN_QUERY_SCAN_H_
 
 #include "query/query.h"
+#include <string>
 
 namespace viya {
 namespace codegen {
@@ -39,7 +40,14 @@ private:
   void UnpackArguments(query::AggregateQuery *query);
 
   void IterationStart(query::FilterBasedQuery *query);
+  void SegmentStart(query::FilterBasedQuery *query,
+                    const std::string &scanned_recs,
+                    const std::string &scanned_segments,
+                    const std::string &first_tuple = "0");
   void IterationEnd();
+  void OutputBatchFunction(query::SelectQuery *query);
+  void SearchDictionary(query::SearchQuery *query);
+  void AddSegmentsPlan();
 
 private:
   Code &code_;
@@ -25,29 +25,26 @@ namespace codegen {
 
 Code SearchQueryGenerator::GenerateCode() const {
   Code code;
-  code.AddHeaders({"unordered_set", "query/output.h", "query/stats.h",
-                   "db/table.h", "db/dictionary.h", "db/store.h",
-                   "util/format.h"});
+  code.AddHeaders({"unordered_set", "query/cancel.h", "query/output.h",
+                   "query/stats.h", "db/table.h", "db/dictionary.h",
+                   "db/store.h", "util/format.h"});
 
   code.AddNamespaces(
       {"db = viya::db", "query = viya::query", "util = viya::util"});
 
+  TableModule table_module(query_.table());
+  code.UseModule(table_module.GenerateCode());
+
   code << "extern \"C\" void viya_query_search(db::Table& table, "
           "query::RowOutput& output, query::QueryStats& stats, "
        << "std::vector<db::AnyNum> fargs, const std::string& term, size_t "
-          "limit) __attribute__((__visibility__(\"default\")));\n";
+          "limit, const query::Cancellation& cancel) "
+          "__attribute__((__visibility__(\"default\")));\n";
 
   code << "extern \"C\" void viya_query_search(db::Table& table, "
           "query::RowOutput& output, query::QueryStats& stats, "
        << "std::vector<db::AnyNum> fargs, const std::string& term, size_t "
-          "limit) {\n";
-
-#ifndef NDEBUG
-  code << "\n// ========= definitions ==========\n";
-#endif
-
-  StoreDefs store_defs(query_.table());
-  code << store_defs.GenerateCode();
+          "limit, const query::Cancellation& cancel) {\n";
 
   ScanVisitor scan_visitor(code);
   query_.Accept(scan_visitor);
@@ -60,7 +57,12 @@ Code SearchQueryGenerator::GenerateCode() const {
 }
 
 query::SearchQueryFn SearchQueryGenerator::Function() {
-  return GenerateFunction<query::SearchQueryFn>(
+  return GenerateTieredFunction<query::SearchQueryFn>(
+      std::string("viya_query_search"));
+}
+
+query::SearchQueryFn SearchQueryGenerator::TryFunction() {
+  return TryGenerateFunction<query::SearchQueryFn>(
       std::string("viya_query_search"));
 }
 
@@ -36,6 +36,7 @@ public:
 
   Code GenerateCode() const;
   query::SearchQueryFn Function();
+  query::SearchQueryFn TryFunction();
 
 private:
   query::SearchQuery &query_;
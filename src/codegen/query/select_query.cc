@@ -24,27 +24,27 @@ namespace codegen {
 
 Code SelectQueryGenerator::GenerateCode() const {
   Code code;
-  code.AddHeaders({"query/output.h", "query/stats.h", "db/table.h",
-                   "db/dictionary.h", "db/store.h", "util/format.h",
-                   "util/string.h"});
+  code.AddHeaders({"query/batch_decoder.h", "query/cancel.h",
+                   "query/cursor.h", "query/output.h", "query/stats.h",
+                   "db/table.h", "db/dictionary.h", "db/store.h",
+                   "util/format.h", "util/string.h"});
 
   code.AddNamespaces(
       {"db = viya::db", "query = viya::query", "util = viya::util"});
 
+  TableModule table_module(query_.table());
+  code.UseModule(table_module.GenerateCode());
+
   code << "extern \"C\" void viya_query_select(db::Table& table, "
           "query::RowOutput& output, query::QueryStats& stats,"
-          "std::vector<db::AnyNum> fargs, size_t skip, size_t limit) "
+          "std::vector<db::AnyNum> fargs, size_t skip, size_t limit, "
+          "query::Cursor& cursor, const query::Cancellation& cancel) "
           "__attribute__((__visibility__(\"default\")));\n";
 
   code << "extern \"C\" void viya_query_select(db::Table& table, "
           "query::RowOutput& output, query::QueryStats& stats,"
-          "std::vector<db::AnyNum> fargs, size_t skip, size_t limit) {\n";
-
-#ifndef NDEBUG
-  code << "\n// ========= definitions ==========\n";
-#endif
-  StoreDefs store_defs(query_.table());
-  code << store_defs.GenerateCode();
+          "std::vector<db::AnyNum> fargs, size_t skip, size_t limit, "
+          "query::Cursor& cursor, const query::Cancellation& cancel) {\n";
 
   ScanVisitor scan_visitor(code);
   query_.Accept(scan_visitor);
@@ -54,7 +54,12 @@ Code SelectQueryGenerator::GenerateCode() const {
 }
 
 query::SelectQueryFn SelectQueryGenerator::Function() {
-  return GenerateFunction<query::SelectQueryFn>(
+  return GenerateTieredFunction<query::SelectQueryFn>(
+      std::string("viya_query_select"));
+}
+
+query::SelectQueryFn SelectQueryGenerator::TryFunction() {
+  return TryGenerateFunction<query::SelectQueryFn>(
       std::string("viya_query_select"));
 }
 
@@ -36,6 +36,7 @@ public:
 
   Code GenerateCode() const;
   query::SelectQueryFn Function();
+  query::SelectQueryFn TryFunction();
 
 private:
   query::SelectQuery &query_;
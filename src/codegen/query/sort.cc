@@ -21,9 +21,11 @@
 namespace viya {
 namespace codegen {
 
+static const size_t PARALLEL_SORT_MIN_SIZE = 100000;
+
 void SortVisitor::Visit(query::AggregateQuery *query) {
   auto sort_columns = query->sort_cols();
-  if (!sort_columns.empty()) {
+  if (!sort_columns.empty() && !TypedSort::Applicable(*query)) {
 #ifndef NDEBUG
     code_ << "\n// ========= sort ==========\n";
 #endif
@@ -62,6 +64,9 @@ void SortVisitor::Visit(query::AggregateQuery *query) {
       code_ << " return false;\n";
     }
     code_ << "});\n";
+    if (query->analyze()) {
+      code_ << "stats.StageEnd(\"sort\");\n";
+    }
 
     // Apply skip & limit during output:
     code_ << "auto post_agg_end = limit > 0 ? post_agg.begin() + skip + limit "
@@ -71,7 +76,170 @@ void SortVisitor::Visit(query::AggregateQuery *query) {
     code_ << " output.Send(*it);\n";
     code_ << " ++stats.output_recs;\n";
     code_ << "}\n";
+    if (query->analyze()) {
+      code_ << "stats.StageEnd(\"output\");\n";
+    }
+  }
+}
+
+bool TypedSort::Applicable(const query::AggregateQuery &query) {
+  if (query.sort_cols().empty()) {
+    return false;
+  }
+  // Time columns are sorted by their formatted value:
+  for (auto &sort_column : query.sort_cols()) {
+    auto col = sort_column.col();
+    if (col->type() == db::Column::Type::DIMENSION &&
+        static_cast<const db::Dimension *>(col)->dim_type() ==
+            db::Dimension::DimType::TIME) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Code TypedSort::GenerateCode() const {
+  Code code;
+  code.AddHeaders({"algorithm", "vector"});
+
+  // Detect count column to divide by for calculating averages:
+  std::string count_field("count");
+  for (auto &metric_col : query_.metric_cols()) {
+    if (metric_col.metric()->agg_type() == db::Metric::AggregationType::COUNT) {
+      count_field = std::to_string(metric_col.metric()->index());
+      break;
+    }
+  }
+
+  code << "typedef AggMap::value_type* SortEntry;\n"
+          "std::vector<SortEntry> sorted;\n";
+
+  // Records are compared by ranks of their string values, so that the
+  // dictionary is locked only for copying the values that are actually used:
+  for (auto &sort_column : query_.sort_cols()) {
+    auto col = sort_column.col();
+    if (col->type() == db::Column::Type::DIMENSION &&
+        static_cast<const db::Dimension *>(col)->dim_type() ==
+            db::Dimension::DimType::STRING) {
+      code.AddHeaders({"cstdint", "numeric", "string"});
+      auto col_idx = std::to_string(col->index());
+      auto dict = "dict" + col_idx;
+      code << "std::vector<uint32_t> rank" << col_idx << ";\n"
+           << "{\n"
+           << " std::vector<size_t> codes;\n"
+           << " codes.reserve(agg_map.size());\n"
+           << " for (auto& e : agg_map) {\n"
+           << "  codes.push_back(e.first._" << col_idx << ");\n"
+           << " }\n"
+           << " std::sort(codes.begin(), codes.end());\n"
+           << " codes.erase(std::unique(codes.begin(), codes.end()), "
+              "codes.end());\n"
+           << " std::vector<std::string> values;\n"
+           << " values.reserve(codes.size());\n"
+           << " " << dict << "->lock().lock_shared();\n"
+           << " auto& c2v = " << dict << "->c2v();\n"
+           << " for (auto code : codes) {\n"
+           << "  values.push_back(c2v[code]);\n"
+           << " }\n"
+           << " " << dict << "->lock().unlock_shared();\n"
+           << " std::vector<size_t> order(codes.size());\n"
+           << " std::iota(order.begin(), order.end(), 0);\n"
+           << " std::sort(order.begin(), order.end(), [&](size_t a, size_t b) "
+              "{\n"
+           << "  return values[a] < values[b];\n"
+           << " });\n"
+           << " rank" << col_idx
+           << ".resize(codes.empty() ? 0 : codes.back() + 1);\n"
+           << " for (size_t r = 0; r < order.size(); ++r) {\n"
+           << "  rank" << col_idx << "[codes[order[r]]] = r;\n"
+           << " }\n"
+           << "}\n";
+    }
+  }
+
+  // Comparator, which returns whether the first record goes before the
+  // second one:
+  bool has_bitset = false;
+  code << "auto sort_cmp = [&](SortEntry a, SortEntry b) {\n";
+  auto &sort_columns = query_.sort_cols();
+  for (size_t i = 0; i < sort_columns.size(); ++i) {
+    auto &sort_column = sort_columns[i];
+    auto col = sort_column.col();
+    auto col_idx = std::to_string(col->index());
+
+    for (auto side : {"a", "b"}) {
+      code << " const auto& " << side << std::to_string(i) << " = ";
+      if (col->type() == db::Column::Type::DIMENSION) {
+        if (static_cast<const db::Dimension *>(col)->dim_type() ==
+            db::Dimension::DimType::STRING) {
+          code << "rank" << col_idx << "[" << side << "->first._" << col_idx
+               << "]";
+        } else {
+          code << side << "->first._" << col_idx;
+        }
+      } else {
+        auto metric = static_cast<const db::Metric *>(col);
+        code << side << "->second._" << col_idx;
+        if (metric->agg_type() == db::Metric::AggregationType::AVG) {
+          code << " / (double) " << side << "->second._" << count_field;
+        } else if (metric->agg_type() == db::Metric::AggregationType::BITSET) {
+          code << ".cardinality()";
+          has_bitset = true;
+        }
+      }
+      code << ";\n";
+    }
+
+    auto first = std::string(sort_column.ascending() ? "a" : "b") +
+                 std::to_string(i);
+    auto second = std::string(sort_column.ascending() ? "b" : "a") +
+                  std::to_string(i);
+    code << " if (" << first << " < " << second << ") return true;\n"
+         << " if (" << second << " < " << first << ") return false;\n";
+  }
+  code << " return false;\n"
+          "};\n";
+
+  code << "for (auto& e : agg_map) {\n";
+  if (query_.having() != nullptr) {
+    FilterComparison comparison(query_.table(), query_.having(), "harg", "");
+    code << " auto& tuple_dims = e.first;\n"
+            " auto& tuple_metrics = e.second;\n"
+            " auto r = "
+         << comparison.GenerateCode() << ";\n"
+         << " if (!r) continue;\n";
+  }
+
+  if (query_.limit() > 0) {
+    // Keep only top records in a bounded heap:
+    code << " if (sorted.size() < skip + limit) {\n"
+            "  sorted.push_back(&e);\n"
+            "  std::push_heap(sorted.begin(), sorted.end(), sort_cmp);\n"
+            " } else if (limit > 0 && sort_cmp(&e, sorted.front())) {\n"
+            "  std::pop_heap(sorted.begin(), sorted.end(), sort_cmp);\n"
+            "  sorted.back() = &e;\n"
+            "  std::push_heap(sorted.begin(), sorted.end(), sort_cmp);\n"
+            " }\n"
+            "}\n"
+            "std::sort_heap(sorted.begin(), sorted.end(), sort_cmp);\n";
+  } else {
+    code << " sorted.push_back(&e);\n"
+            "}\n";
+    // Cached bitset cardinality is updated on access, therefore it can't be
+    // compared concurrently:
+    if (!has_bitset) {
+      code << "if (sorted.size() >= "
+           << std::to_string(PARALLEL_SORT_MIN_SIZE) << ") {\n"
+           << " query::ParallelSort(parallel, sorted.begin(), sorted.end(), "
+              "sort_cmp);\n"
+              "} else {\n"
+              " std::sort(sorted.begin(), sorted.end(), sort_cmp);\n"
+              "}\n";
+    } else {
+      code << "std::sort(sorted.begin(), sorted.end(), sort_cmp);\n";
+    }
   }
+  return code;
 }
 
 } // namespace codegen
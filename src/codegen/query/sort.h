@@ -35,6 +35,27 @@ private:
   Code &code_;
 };
 
+/**
+ * Generates sorting of pointers to aggregated records, which compares raw
+ * aggregated values. When there's a limit, only top records are kept in a
+ * bounded heap. This way records are only formatted when they are output.
+ */
+class TypedSort : public CodeGenerator {
+public:
+  TypedSort(const query::AggregateQuery &query) : query_(query) {}
+  DISALLOW_COPY_AND_MOVE(TypedSort);
+
+  /**
+   * @return whether the query result can be sorted prior to materialization
+   */
+  static bool Applicable(const query::AggregateQuery &query);
+
+  Code GenerateCode() const;
+
+private:
+  const query::AggregateQuery &query_;
+};
+
 } // namespace codegen
 } // namespace viya
 
@@ -17,7 +17,10 @@
 #include "db/database.h"
 #include "db/table.h"
 #include "input/loader_factory.h"
+#include "input/stream_loader.h"
 #include "query/runner.h"
+#include <algorithm>
+#include <chrono>
 #include <glog/logging.h>
 #include <memory>
 #include <nlohmann/json.hpp>
@@ -26,12 +29,19 @@ namespace viya {
 namespace db {
 
 Database::Database(const util::Config &config)
-    : Database(config, 1, config.num("query_threads", 1)) {}
+    : Database(config, config.num("write_threads", 1),
+               config.num("query_threads", 1)) {}
 
 Database::Database(const util::Config &config, size_t write_threads,
                    size_t read_threads)
-    : compiler_(config), write_pool_(write_threads), read_pool_(read_threads),
-      watcher_(*this), last_batch_id_(0L) {
+    : compiler_(config), write_scheduler_(write_threads, statsd_),
+      query_parallelism_(std::max(config.num("query_parallelism", 1), 1L)),
+      interpret_queries_(config.boolean("interpret_queries", false)),
+      scan_pool_(std::max(config.num("scan_threads", query_parallelism_), 1L)),
+      read_pool_(read_threads),
+      query_scheduler_(config, read_pool_, read_threads, statsd_),
+      watcher_(*this), warmup_(config, *this), result_cache_(config, *this),
+      last_batch_id_(0L) {
 
   if (config.exists("tables")) {
     for (const util::Config &table_conf : config.sublist("tables")) {
@@ -45,6 +55,7 @@ Database::Database(const util::Config &config, size_t write_threads,
 }
 
 Database::~Database() {
+  warmup_.Stop();
   for (auto &it : tables_) {
     delete it.second;
   }
@@ -63,6 +74,7 @@ void Database::CreateTable(const std::string &name,
     throw std::runtime_error("Table already exists: " + name);
   }
   tables_.insert(std::make_pair(name, new Table(table_conf, *this)));
+  warmup_.Replay(name);
 }
 
 void Database::DropTable(const std::string &name) {
@@ -75,6 +87,7 @@ void Database::DropTable(const std::string &name) {
   auto table = it->second;
   tables_.erase(it);
   delete table;
+  result_cache_.Clear();
 }
 
 Table *Database::GetTable(const std::string &name) {
@@ -103,23 +116,98 @@ void Database::PrintMetadata(std::string &metadata) {
 
 query::QueryStats Database::Query(const util::Config &query_conf,
                                   query::RowOutput &output) {
-  query::QueryFactory query_factory;
-  std::unique_ptr<query::Query> q(query_factory.Create(query_conf, *this));
-  query::QueryRunner query_runner(*this, output);
-  q->Accept(query_runner);
-  return query_runner.stats();
+  query::Cancellation cancellation;
+  return Query(query_conf, output, cancellation);
+}
+
+query::QueryStats Database::Query(const util::Config &query_conf,
+                                  query::RowOutput &output,
+                                  query::Cancellation &cancellation) {
+  if (query_conf.exists("timeout")) {
+    cancellation.SetTimeout(
+        std::chrono::milliseconds(query_conf.num("timeout")));
+  }
+  auto stats =
+      result_cache_.Run(query_conf, output, [&](query::RowOutput &out) {
+        query::QueryFactory query_factory;
+        std::unique_ptr<query::Query> q(
+            query_factory.Create(query_conf, *this));
+        query::QueryRunner query_runner(*this, out, cancellation);
+        q->Accept(query_runner);
+        return query_runner.stats();
+      });
+  warmup_.Record(query_conf);
+  return stats;
 }
 
 void Database::Load(const util::Config &load_conf) {
+  if (IsBatchApplied(load_conf)) {
+    return;
+  }
   input::LoaderFactory loader_factory;
   std::unique_ptr<input::Loader> loader(
       loader_factory.Create(load_conf, *this));
   loader->LoadData();
+  OnBatchApplied(load_conf);
+}
 
+void Database::Load(const util::Config &load_conf, std::istream &stream) {
+  if (load_conf.exists("idempotency_key") && !load_conf.exists("batch_id")) {
+    throw std::invalid_argument("Idempotency key requires a batch ID");
+  }
+  // The producer must learn that its input was not loaded:
+  if (IsBatchApplied(load_conf)) {
+    throw BatchAlreadyApplied(load_conf.num("batch_id"),
+                              load_conf.str("idempotency_key"));
+  }
+  input::StreamLoader loader(load_conf, *GetTable(load_conf.str("table")),
+                             stream);
+  loader.LoadData();
+  OnBatchApplied(load_conf);
+}
+
+/**
+ * Batch is identified by its ID and the original input file, since the file
+ * that's actually loaded may be a temporary copy. Streamed input has no file,
+ * so it's identified by the idempotency key given by the producer. Input
+ * without a source identity is never deduplicated, since unrelated inputs
+ * may share the batch ID.
+ */
+static std::string BatchSource(const util::Config &load_conf) {
+  if (load_conf.exists("idempotency_key")) {
+    return "key:" + load_conf.str("idempotency_key");
+  }
+  return load_conf.str("source_file", load_conf.str("file", ""));
+}
+
+bool Database::IsBatchApplied(const util::Config &load_conf) {
+  if (!load_conf.exists("batch_id")) {
+    return false;
+  }
+  long id = load_conf.num("batch_id");
+  auto source = BatchSource(load_conf);
+  if (source.empty()) {
+    return false;
+  }
+  auto table = GetTable(load_conf.str("table"));
+  if (table->applied_batches().Contains(id, source)) {
+    LOG(WARNING) << "Skipping already applied batch " << id << " (" << source
+                 << ")";
+    return true;
+  }
+  return false;
+}
+
+void Database::OnBatchApplied(const util::Config &load_conf) {
   if (load_conf.exists("batch_id")) {
-    auto id = load_conf.num("batch_id");
-    if (id > last_batch_id_) {
-      last_batch_id_ = id;
+    long id = load_conf.num("batch_id");
+    auto source = BatchSource(load_conf);
+    if (!source.empty()) {
+      GetTable(load_conf.str("table"))->applied_batches().Add(id, source);
+    }
+
+    long last_id = last_batch_id_.load();
+    while (id > last_id && !last_batch_id_.compare_exchange_weak(last_id, id)) {
     }
   }
 }
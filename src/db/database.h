@@ -19,14 +19,23 @@
 
 #include "codegen/compiler.h"
 #include "db/dictionary.h"
+#include "db/query_scheduler.h"
+#include "db/write_scheduler.h"
 #include "input/watcher.h"
+#include "query/cancel.h"
 #include "query/output.h"
+#include "query/result_cache.h"
 #include "query/stats.h"
+#include "query/warmup.h"
 #include "util/config.h"
 #include "util/macros.h"
 #include "util/rwlock.h"
 #include "util/statsd.h"
 #include <ThreadPool/ThreadPool.h>
+#include <atomic>
+#include <istream>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 
 namespace viya {
@@ -38,6 +47,18 @@ namespace input = viya::input;
 
 class Table;
 
+/**
+ * Thrown when streamed input is replayed with the idempotency key of a batch
+ * that was already applied
+ */
+class BatchAlreadyApplied : public std::runtime_error {
+public:
+  BatchAlreadyApplied(long batch_id, const std::string &key)
+      : std::runtime_error("Batch " + std::to_string(batch_id) +
+                           " with idempotency key '" + key +
+                           "' was already applied") {}
+};
+
 class Database {
 public:
   Database(const util::Config &config);
@@ -56,31 +77,66 @@ public:
   cg::Compiler &compiler() { return compiler_; }
   Dictionaries &dicts() { return dicts_; }
   ThreadPool &read_pool() { return read_pool_; }
-  ThreadPool &write_pool() { return write_pool_; }
+  QueryScheduler &query_scheduler() { return query_scheduler_; }
+  ThreadPool &scan_pool() { return scan_pool_; }
+  size_t query_parallelism() const { return query_parallelism_; }
+  bool interpret_queries() const { return interpret_queries_; }
+  WriteScheduler &write_scheduler() { return write_scheduler_; }
   input::Watcher &watcher() { return watcher_; }
+  query::Warmup &warmup() { return warmup_; }
+  query::ResultCache &result_cache() { return result_cache_; }
   const util::Statsd &statsd() const { return statsd_; }
   const std::unordered_map<std::string, Table *> &tables() const {
     return tables_;
   }
-  long last_batch_id() const { return last_batch_id_; }
+  long last_batch_id() const { return last_batch_id_.load(); }
 
   query::QueryStats Query(const util::Config &query_conf,
                           query::RowOutput &output);
+
+  /**
+   * Runs a query that can be cancelled by the caller. Query's "timeout" (in
+   * milliseconds) cancels it once exceeded.
+   *
+   * @throws query::QueryCancelled with partial stats, if cancelled
+   */
+  query::QueryStats Query(const util::Config &query_conf,
+                          query::RowOutput &output,
+                          query::Cancellation &cancellation);
   void Load(const util::Config &load_conf);
 
+  /**
+   * Loads streamed input. Only input that has both "batch_id" and
+   * "idempotency_key" is checked for being already applied.
+   *
+   * @throws BatchAlreadyApplied if the batch is replayed
+   */
+  void Load(const util::Config &load_conf, std::istream &stream);
+
+private:
+  bool IsBatchApplied(const util::Config &load_conf);
+  void OnBatchApplied(const util::Config &load_conf);
+
 private:
   cg::Compiler compiler_;
   std::unordered_map<std::string, Table *> tables_;
   folly::RWSpinLock lock_;
   Dictionaries dicts_;
 
-  ThreadPool write_pool_;
+  util::Statsd statsd_;
+
+  WriteScheduler write_scheduler_;
+  size_t query_parallelism_;
+  bool interpret_queries_;
+  ThreadPool scan_pool_;
   ThreadPool read_pool_;
+  QueryScheduler query_scheduler_;
 
   input::Watcher watcher_;
-  util::Statsd statsd_;
+  query::Warmup warmup_;
+  query::ResultCache result_cache_;
 
-  long last_batch_id_;
+  std::atomic<long> last_batch_id_;
 };
 } // namespace db
 } // namespace viya
@@ -20,7 +20,7 @@ namespace viya {
 namespace db {
 
 DimensionDict::DimensionDict(const BaseNumType &code_type)
-    : size_(code_type.size()) {
+    : size_(code_type.size()), users_(0) {
   std::string exceeded_value("__exceeded");
   c2v_.push_back(exceeded_value);
 
@@ -19,6 +19,7 @@
 
 #include "db/column.h"
 #include "util/rwlock.h"
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 
@@ -44,8 +45,21 @@ public:
 
   AnyNum Decode(const std::string &value);
 
+  /**
+   * Dictionaries are shared between dimensions of the same name, and they
+   * outlive dropped tables. Only a dictionary that was never shared holds
+   * just the values of the table it belongs to.
+   */
+  bool shared() const { return users_.load() > 1; }
+
+  /**
+   * Registers a table dimension that stores codes of this dictionary
+   */
+  void AddUser() { ++users_; }
+
 private:
   BaseNumType::Size size_;
+  std::atomic<size_t> users_;
   folly::RWSpinLock lock_;
   std::vector<std::string> c2v_; // code to value
   void *v2c_;                    // value to code
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db/query_scheduler.h"
+#include "util/config.h"
+#include "util/statsd.h"
+#include <algorithm>
+#include <memory>
+
+namespace viya {
+namespace db {
+
+QueryScheduler::QueryScheduler(const util::Config &config, ThreadPool &pool,
+                               size_t threads, const util::Statsd &statsd)
+    : pool_(pool), threads_(std::max(threads, (size_t)1)), statsd_(statsd),
+      running_(0) {
+  if (config.exists("query_classes")) {
+    long position = 0;
+    for (auto &class_conf : config.sublist("query_classes")) {
+      classes_.push_back(
+          {class_conf.str("name"), class_conf.num("priority", position++),
+           (size_t)class_conf.num("max_concurrent", 0),
+           (size_t)class_conf.num("max_queued", 0), {}, 0});
+    }
+    if (classes_.empty()) {
+      throw std::invalid_argument("No query classes defined");
+    }
+  } else {
+    classes_.push_back(
+        {"default", 0, 0, (size_t)config.num("query_max_queued", 0), {}, 0});
+  }
+  default_class_ = config.str("default_query_class", classes_.front().name);
+
+  std::stable_sort(classes_.begin(), classes_.end(),
+                   [](const QueryClass &c1, const QueryClass &c2) {
+                     return c1.priority < c2.priority;
+                   });
+  FindClass(default_class_);
+}
+
+QueryScheduler::~QueryScheduler() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] {
+    return running_ == 0 &&
+           std::all_of(classes_.begin(), classes_.end(),
+                       [](const QueryClass &c) { return c.tasks.empty(); });
+  });
+}
+
+QueryScheduler::QueryClass &
+QueryScheduler::FindClass(const std::string &name) {
+  for (auto &query_class : classes_) {
+    if (query_class.name == name) {
+      return query_class;
+    }
+  }
+  throw std::invalid_argument("Unknown query class: " + name);
+}
+
+std::future<void> QueryScheduler::Enqueue(const std::string &class_name,
+                                          std::function<void()> fn) {
+  auto task = std::make_shared<std::packaged_task<void()>>(std::move(fn));
+  auto future = task->get_future();
+
+  std::string name;
+  size_t depth;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &query_class =
+        FindClass(class_name.empty() ? default_class_ : class_name);
+    name = query_class.name;
+    if (query_class.max_queued > 0 &&
+        query_class.tasks.size() >= query_class.max_queued) {
+      statsd_.Increment("reader." + name + ".rejected");
+      throw QueryRejected(name);
+    }
+    query_class.tasks.push_back(
+        {[task] { (*task)(); }, cr::steady_clock::now()});
+    depth = query_class.tasks.size();
+    Dispatch();
+  }
+  statsd_.Gauge("reader." + name + ".queue_depth", depth);
+  return future;
+}
+
+/**
+ * Starts as many waiting queries as there are free threads. Must be called
+ * while holding the lock.
+ */
+void QueryScheduler::Dispatch() {
+  while (running_ < threads_) {
+    auto it = std::find_if(
+        classes_.begin(), classes_.end(), [](const QueryClass &c) {
+          return !c.tasks.empty() &&
+                 (c.max_concurrent == 0 || c.running < c.max_concurrent);
+        });
+    if (it == classes_.end()) {
+      break;
+    }
+    auto &query_class = *it;
+    auto task = std::move(query_class.tasks.front());
+    query_class.tasks.pop_front();
+    ++query_class.running;
+    ++running_;
+    pool_.enqueue(
+        [this, &query_class, task] { Run(query_class, std::move(task)); });
+  }
+}
+
+void QueryScheduler::Run(QueryClass &query_class, Task task) {
+  auto wait_time = cr::duration_cast<cr::milliseconds>(
+                       cr::steady_clock::now() - task.enqueued)
+                       .count();
+  statsd_.Timing("reader." + query_class.name + ".wait_time", wait_time);
+
+  // Packaged task stores exception in its future, so this never throws:
+  task.fn();
+
+  size_t depth;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --query_class.running;
+    --running_;
+    depth = query_class.tasks.size();
+    Dispatch();
+    if (running_ == 0) {
+      idle_.notify_all();
+    }
+  }
+  statsd_.Gauge("reader." + query_class.name + ".queue_depth", depth);
+}
+
+size_t QueryScheduler::queue_depth(const std::string &class_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return FindClass(class_name).tasks.size();
+}
+} // namespace db
+} // namespace viya
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_DB_QUERY_SCHEDULER_H_
+#define VIYA_DB_QUERY_SCHEDULER_H_
+
+#include "util/macros.h"
+#include <ThreadPool/ThreadPool.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace viya {
+namespace util {
+class Config;
+class Statsd;
+} // namespace util
+} // namespace viya
+
+namespace viya {
+namespace db {
+
+namespace util = viya::util;
+namespace cr = std::chrono;
+
+/**
+ * Thrown when a query can't be admitted, since its class queue is full
+ */
+class QueryRejected : public std::runtime_error {
+public:
+  QueryRejected(const std::string &query_class)
+      : std::runtime_error("Too many queued queries of class: " +
+                           query_class) {}
+};
+
+/**
+ * Schedules queries on the read pool. Every query belongs to a class, which
+ * has a priority, a limit on the number of concurrently running queries, and
+ * a limit on the number of waiting ones. Whenever a thread is available, the
+ * next query is taken from the highest priority class that hasn't reached
+ * its concurrency limit. Queries of the same class run in the order they were
+ * submitted.
+ *
+ * Classes are defined in the "query_classes" configuration list, for
+ * example:
+ *
+ *   {"name": "interactive", "priority": 0, "max_queued": 1000},
+ *   {"name": "batch", "priority": 1, "max_concurrent": 1, "max_queued": 10}
+ *
+ * Lower priority value runs first. Zero limits mean no limit. Without this
+ * setting, there's a single "default" class limited by "query_max_queued".
+ */
+class QueryScheduler {
+public:
+  QueryScheduler(const util::Config &config, ThreadPool &pool, size_t threads,
+                 const util::Statsd &statsd);
+  DISALLOW_COPY_AND_MOVE(QueryScheduler);
+
+  /**
+   * Waits for all the scheduled queries to complete
+   */
+  ~QueryScheduler();
+
+  /**
+   * @param query_class class name, or empty string for the default class
+   * @throws QueryRejected if the class queue is full
+   * @throws std::invalid_argument if there's no such class
+   */
+  std::future<void> Enqueue(const std::string &query_class,
+                            std::function<void()> fn);
+
+  const std::string &default_class() const { return default_class_; }
+
+  size_t queue_depth(const std::string &query_class);
+
+private:
+  struct Task {
+    std::function<void()> fn;
+    cr::steady_clock::time_point enqueued;
+  };
+
+  struct QueryClass {
+    std::string name;
+    long priority;
+    size_t max_concurrent;
+    size_t max_queued;
+    std::deque<Task> tasks;
+    size_t running;
+  };
+
+  QueryClass &FindClass(const std::string &name);
+  void Dispatch();
+  void Run(QueryClass &query_class, Task task);
+
+private:
+  ThreadPool &pool_;
+  const size_t threads_;
+  const util::Statsd &statsd_;
+  std::string default_class_;
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  std::vector<QueryClass> classes_;
+  size_t running_;
+};
+} // namespace db
+} // namespace viya
+
+#endif // VIYA_DB_QUERY_SCHEDULER_H_
@@ -19,6 +19,7 @@
 
 #include "util/macros.h"
 #include "util/rwlock.h"
+#include <vector>
 
 namespace viya {
 namespace db {
@@ -40,6 +41,13 @@ public:
 
   size_t capacity() const { return capacity_; }
 
+  /**
+   * @return raw pointers to the dimension columns followed by the metric
+   * columns, in the order of their indices. If the table contains an average
+   * metric without a count metric, the last column is the implicit count.
+   */
+  virtual std::vector<void *> columns() = 0;
+
 protected:
   size_t size_;
   size_t capacity_;
@@ -18,13 +18,20 @@
 #include "db/database.h"
 #include "db/store.h"
 #include "db/table.h"
+#include <atomic>
 
 namespace viya {
 namespace db {
 
 namespace cg = viya::codegen;
 
-SegmentStore::SegmentStore(Database &database, Table &table) {
+static uint64_t NextLayoutVersion() {
+  static std::atomic<uint64_t> last_version(0);
+  return ++last_version;
+}
+
+SegmentStore::SegmentStore(Database &database, Table &table)
+    : layout_version_(NextLayoutVersion()) {
   create_segment_ =
       cg::StoreFunctions(database.compiler(), table).CreateSegmentFunction();
 }
@@ -20,6 +20,7 @@
 #include "db/segment.h"
 #include "util/macros.h"
 #include "util/rwlock.h"
+#include <cstdint>
 #include <vector>
 
 namespace viya {
@@ -43,6 +44,15 @@ public:
     return copy;
   }
 
+  /**
+   * Identifies the arrangement of segments in this store. Positions of tuples
+   * taken under one layout version are valid as long as the version stays
+   * the same. Segments are only appended, so the version only changes when
+   * the table is re-created. Code that removes or reorders segments must
+   * assign a new version.
+   */
+  uint64_t layout_version() const { return layout_version_; }
+
   SegmentBase *last() {
     if (segments_.empty() || segments_.back()->full()) {
       folly::RWSpinLock::WriteHolder guard(lock_);
@@ -55,6 +65,7 @@ private:
   std::vector<SegmentBase *> segments_;
   folly::RWSpinLock lock_;
   CreateSegmentFn create_segment_;
+  uint64_t layout_version_;
 };
 } // namespace db
 } // namespace viya
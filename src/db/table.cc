@@ -21,7 +21,9 @@
 #include "db/database.h"
 #include "db/store.h"
 #include "util/sanitize.h"
+#include <algorithm>
 #include <chrono>
+#include <nlohmann/json.hpp>
 #include <stdexcept>
 
 namespace viya {
@@ -31,6 +33,8 @@ namespace cg = viya::codegen;
 namespace util = viya::util;
 namespace cr = std::chrono;
 
+using json = nlohmann::json;
+
 CardinalityGuard::CardinalityGuard(const util::Config &config,
                                    const Dimension *dim, const Table &table)
     : dim_(dim) {
@@ -44,8 +48,79 @@ CardinalityGuard::CardinalityGuard(const util::Config &config,
   limit_ = config.num("limit");
 }
 
-Table::Table(const util::Config &config, Database &database)
-    : database_(database), segment_size_(config.num("segment_size", 1000000L)) {
+bool AppliedBatches::Contains(long batch_id, const std::string &source) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = batches_.find(batch_id);
+  return it != batches_.end() && it->second.count(source) > 0;
+}
+
+void AppliedBatches::Add(long batch_id, const std::string &source) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  batches_[batch_id].insert(source);
+  while (batches_.size() > history_) {
+    batches_.erase(batches_.begin());
+  }
+}
+
+/**
+ * Builds configuration of a rollup view, which is a table that contains a
+ * subset of the base table dimensions and all of its metrics. Time dimensions
+ * of the view can be truncated to a coarser granularity.
+ */
+static util::Config ViewConfig(const util::Config &table_conf,
+                               const util::Config &view_conf) {
+  auto view_name = view_conf.str("name");
+  auto view_dims = view_conf.strlist("dimensions");
+  auto has_dim = [&view_dims](const std::string &name) {
+    return std::find(view_dims.begin(), view_dims.end(), name) !=
+           view_dims.end();
+  };
+
+  json config = *table_conf.json_ptr();
+  config.erase("views");
+  config.erase("watch");
+  config["name"] = table_conf.str("name") + "." + view_name;
+
+  json dimensions = json::array();
+  for (auto dim_conf : config["dimensions"]) {
+    auto dim_name = dim_conf["name"].get<std::string>();
+    if (!has_dim(dim_name)) {
+      continue;
+    }
+    std::string dim_type = dim_conf.value("type", "string");
+    if (view_conf.exists("granularity") &&
+        (dim_type == "time" || dim_type == "microtime")) {
+      if (dim_conf.count("rollup_rules")) {
+        throw std::invalid_argument("Rollup view '" + view_name +
+                                    "' can't change granularity of dimension "
+                                    "with rollup rules: " +
+                                    dim_name);
+      }
+      dim_conf["granularity"] = view_conf.str("granularity");
+    }
+    if (dim_conf.count("cardinality_guard")) {
+      for (auto &guard_dim : dim_conf["cardinality_guard"]["dimensions"]) {
+        if (!has_dim(guard_dim.get<std::string>())) {
+          throw std::invalid_argument(
+              "Rollup view '" + view_name + "' must contain all dimensions " +
+              "of cardinality guard defined on: " + dim_name);
+        }
+      }
+    }
+    dimensions.push_back(dim_conf);
+  }
+  if (dimensions.size() != view_dims.size()) {
+    throw std::invalid_argument("Rollup view '" + view_name +
+                                "' refers to unknown dimensions");
+  }
+  config["dimensions"] = dimensions;
+  return util::Config(config);
+}
+
+Table::Table(const util::Config &config, Database &database, bool view)
+    : database_(database), segment_size_(config.num("segment_size", 1000000L)),
+      applied_batches_(config.num("batch_history", 1000L)), data_version_(0),
+      writers_(0) {
 
   name_ = config.str("name");
   util::check_legal_string("Table name", name_);
@@ -54,8 +129,13 @@ Table::Table(const util::Config &config, Database &database)
   for (util::Config &dim_config : config.sublist("dimensions")) {
     std::string dim_type = dim_config.str("type", "string");
     if (dim_type == "string") {
-      dimensions_.push_back(
-          new StrDimension(dim_config, dim_idx++, database.dicts()));
+      auto dim = new StrDimension(dim_config, dim_idx++, database.dicts());
+      // Views only hold values of their base table, so they don't make the
+      // dictionary shared:
+      if (!view) {
+        dim->dict()->AddUser();
+      }
+      dimensions_.push_back(dim);
     } else if (dim_type == "boolean") {
       dimensions_.push_back(new BoolDimension(dim_config, dim_idx++));
     } else if (dim_type == "time") {
@@ -90,6 +170,13 @@ Table::Table(const util::Config &config, Database &database)
       cg::StoreFunctions(database_.compiler(), *this).UpsertContextFunction();
   upsert_ctx_ = upsert_ctx(*this);
 
+  if (config.exists("views")) {
+    for (util::Config &view_conf : config.sublist("views")) {
+      views_.push_back(
+          new Table(ViewConfig(config, view_conf), database, true));
+    }
+  }
+
   if (config.exists("watch")) {
     database_.watcher().AddWatch(config.sub("watch"), this);
   }
@@ -98,6 +185,10 @@ Table::Table(const util::Config &config, Database &database)
 Table::~Table() {
   database_.watcher().RemoveWatch(this);
 
+  for (auto v : views_) {
+    delete v;
+  }
+
   for (auto d : dimensions_) {
     delete d;
   }
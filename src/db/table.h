@@ -20,6 +20,10 @@
 #include "db/stats.h"
 #include "util/config.h"
 #include "util/macros.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -50,9 +54,33 @@ private:
   size_t limit_;
 };
 
+/**
+ * Keeps track of input batches applied to a table, so that a replayed batch
+ * can be skipped instead of being counted twice. Only the most recent batch
+ * IDs are remembered.
+ */
+class AppliedBatches {
+public:
+  AppliedBatches(size_t history) : history_(history) {}
+  DISALLOW_COPY_AND_MOVE(AppliedBatches);
+
+  bool Contains(long batch_id, const std::string &source) const;
+  void Add(long batch_id, const std::string &source);
+
+private:
+  mutable std::mutex mutex_;
+  const size_t history_;
+  std::map<long, std::set<std::string>> batches_;
+};
+
 class Table {
 public:
-  Table(const util::Config &config, class Database &database);
+  /**
+   * @param view whether this is a rollup view maintained together with its
+   *             base table
+   */
+  Table(const util::Config &config, class Database &database,
+        bool view = false);
   DISALLOW_COPY_AND_MOVE(Table);
   ~Table();
 
@@ -77,6 +105,29 @@ public:
   }
   void *upsert_ctx() { return upsert_ctx_; }
 
+  /**
+   * @return rollup views of this table, which are maintained by the loaders
+   *         of this table
+   */
+  const std::vector<Table *> &views() const { return views_; }
+  AppliedBatches &applied_batches() { return applied_batches_; }
+
+  /**
+   * Data version changes whenever the table data is modified, so query
+   * results can be reused while the version remains the same, and there are
+   * no writes in progress.
+   */
+  uint64_t data_version() const { return data_version_.load(); }
+  bool writing() const { return writers_.load() > 0; }
+  void BeginWrite() {
+    ++writers_;
+    ++data_version_;
+  }
+  void EndWrite() {
+    ++data_version_;
+    --writers_;
+  }
+
   void PrintMetadata(std::string &);
 
 private:
@@ -88,6 +139,10 @@ private:
   size_t segment_size_;
   std::vector<CardinalityGuard> cardinality_guards_;
   void *upsert_ctx_;
+  AppliedBatches applied_batches_;
+  std::vector<Table *> views_;
+  std::atomic<uint64_t> data_version_;
+  std::atomic<size_t> writers_;
 };
 } // namespace db
 } // namespace viya
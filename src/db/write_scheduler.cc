@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db/write_scheduler.h"
+#include "util/statsd.h"
+#include <memory>
+
+namespace viya {
+namespace db {
+
+WriteScheduler::WriteScheduler(size_t threads, const util::Statsd &statsd)
+    : statsd_(statsd), pool_(threads) {}
+
+WriteScheduler::~WriteScheduler() { WaitIdle(); }
+
+void WriteScheduler::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return lanes_.empty(); });
+}
+
+std::future<void> WriteScheduler::Enqueue(const std::string &lane,
+                                          std::function<void()> fn) {
+  auto task = std::make_shared<std::packaged_task<void()>>(std::move(fn));
+  auto future = task->get_future();
+
+  size_t depth;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &tasks = lanes_[lane].tasks;
+    tasks.push_back({[task] { (*task)(); }, cr::steady_clock::now()});
+    depth = tasks.size();
+  }
+  statsd_.Gauge("writer." + lane + ".queue_depth", depth);
+
+  // Lane that was empty has no running task, so it must be activated:
+  if (depth == 1) {
+    pool_.enqueue([this, lane] { RunNext(lane); });
+  }
+  return future;
+}
+
+void WriteScheduler::RunNext(const std::string &lane) {
+  Task task;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task = lanes_[lane].tasks.front();
+  }
+
+  auto wait_time = cr::duration_cast<cr::milliseconds>(
+                       cr::steady_clock::now() - task.enqueued)
+                       .count();
+  statsd_.Timing("writer." + lane + ".wait_time", wait_time);
+
+  // Packaged task stores exception in its future, so this never throws:
+  task.fn();
+
+  size_t depth;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = lanes_.find(lane);
+    it->second.tasks.pop_front();
+    depth = it->second.tasks.size();
+    if (depth == 0) {
+      lanes_.erase(it);
+      if (lanes_.empty()) {
+        idle_.notify_all();
+      }
+    }
+  }
+  statsd_.Gauge("writer." + lane + ".queue_depth", depth);
+
+  if (depth > 0) {
+    pool_.enqueue([this, lane] { RunNext(lane); });
+  }
+}
+
+size_t WriteScheduler::queue_depth(const std::string &lane) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = lanes_.find(lane);
+  return it == lanes_.end() ? 0 : it->second.tasks.size();
+}
+} // namespace db
+} // namespace viya
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_DB_WRITE_SCHEDULER_H_
+#define VIYA_DB_WRITE_SCHEDULER_H_
+
+#include "util/macros.h"
+#include <ThreadPool/ThreadPool.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace viya {
+namespace util {
+class Statsd;
+}
+} // namespace viya
+
+namespace viya {
+namespace db {
+
+namespace util = viya::util;
+namespace cr = std::chrono;
+
+/**
+ * Schedules write tasks on a shared pool of threads. Every task belongs to a
+ * lane (normally, a table name): tasks of the same lane are executed one at a
+ * time in the order they were submitted, while different lanes progress
+ * concurrently. After running a single task a lane yields its thread, so a
+ * long queue of loads into one table doesn't starve the others.
+ */
+class WriteScheduler {
+public:
+  WriteScheduler(size_t threads, const util::Statsd &statsd);
+  DISALLOW_COPY_AND_MOVE(WriteScheduler);
+
+  /**
+   * Waits for all the scheduled tasks to complete
+   */
+  ~WriteScheduler();
+
+  std::future<void> Enqueue(const std::string &lane, std::function<void()> fn);
+
+  /**
+   * Waits until there are no scheduled or running tasks in any lane
+   */
+  void WaitIdle();
+
+  size_t queue_depth(const std::string &lane);
+
+private:
+  struct Task {
+    std::function<void()> fn;
+    cr::steady_clock::time_point enqueued;
+  };
+
+  struct Lane {
+    std::deque<Task> tasks;
+  };
+
+  void RunNext(const std::string &lane);
+
+private:
+  const util::Statsd &statsd_;
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  std::unordered_map<std::string, Lane> lanes_;
+  ThreadPool pool_;
+};
+} // namespace db
+} // namespace viya
+
+#endif // VIYA_DB_WRITE_SCHEDULER_H_
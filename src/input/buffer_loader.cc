@@ -25,35 +25,38 @@
 namespace viya {
 namespace input {
 
+static const size_t MAX_TUPLE_SIZE = 1024000;
+
 BufferLoader::BufferLoader(const util::Config &config, db::Table &table)
-    : Loader(config, table), buf_(nullptr), buf_size_(0L) {}
+    : BufferLoader(config, table, nullptr, 0L) {}
 
 BufferLoader::BufferLoader(const util::Config &config, db::Table &table,
                            const char *buf, size_t buf_size)
-    : Loader(config, table), buf_(buf), buf_size_(buf_size) {}
-
-void BufferLoader::LoadTsv() {
-  static const size_t MAX_TUPLE_SIZE = 1024000;
-  static char line[MAX_TUPLE_SIZE];
+    : Loader(config, table), buf_(buf), buf_size_(buf_size),
+      tuple_(desc_.columns_num()), line_(MAX_TUPLE_SIZE), line_num_(1) {
 
   size_t cols_num = desc_.columns_num();
-
-  std::vector<std::string> tuple(cols_num);
-  for (auto &s : tuple) {
+  for (auto &s : tuple_) {
     s.reserve(MAX_TUPLE_SIZE / cols_num);
   }
+}
 
-  size_t line_num = 1;
-  const char *buf_end = buf_ + buf_size_;
+void BufferLoader::LoadTsv(const char *buf, size_t buf_size) {
+  size_t cols_num = desc_.columns_num();
+  char *line = line_.data();
+  const char *buf_end = buf + buf_size;
 
   // Read lines:
-  for (const char *lstart = buf_; lstart < buf_end;) {
+  for (const char *lstart = buf; lstart < buf_end;) {
     const char *lend = (const char *)memchr(lstart, '\n', buf_end - lstart);
     if (lend == NULL) {
       lend = buf_end;
     }
-    assert((size_t)(lend - lstart + 1) < MAX_TUPLE_SIZE);
-    memcpy(line, lstart, lend - lstart + 1);
+    if ((size_t)(lend - lstart) >= MAX_TUPLE_SIZE) {
+      throw std::runtime_error("at line " + std::to_string(line_num_) +
+                               " (line is too long)");
+    }
+    memcpy(line, lstart, lend - lstart);
     line[lend - lstart] = '\0';
 
     // Parse tuples:
@@ -67,7 +70,7 @@ void BufferLoader::LoadTsv() {
           throw std::runtime_error("number of input columns is too big: " +
                                    std::to_string(tuple_idx + 1));
         }
-        tuple[tuple_idx++].assign(tp_start, tp - tp_start);
+        tuple_[tuple_idx++].assign(tp_start, tp - tp_start);
         tp_start = tp + 1;
       }
       tp++;
@@ -77,14 +80,14 @@ void BufferLoader::LoadTsv() {
         throw std::runtime_error("number of input columns is too big: " +
                                  std::to_string(tuple_idx + 1));
       }
-      tuple[tuple_idx++].assign(tp_start, tp - tp_start);
+      tuple_[tuple_idx++].assign(tp_start, tp - tp_start);
     }
 
     try {
-      Load(tuple);
-      ++line_num;
+      Load(tuple_);
+      ++line_num_;
     } catch (std::exception &e) {
-      throw std::runtime_error("at line " + std::to_string(line_num) + " (" +
+      throw std::runtime_error("at line " + std::to_string(line_num_) + " (" +
                                std::string(e.what()) + ")");
     }
     ++stats_.total_recs;
@@ -94,10 +97,10 @@ void BufferLoader::LoadTsv() {
 
 void BufferLoader::LoadData() {
   stats_.OnBegin();
-  BeforeLoad();
+  auto writing = BeforeLoad();
 
   if (desc_.format() == LoaderDesc::Format::TSV) {
-    LoadTsv();
+    LoadTsv(buf_, buf_size_);
   } else {
     throw std::runtime_error("unknown input format (supported formats: TSV)");
   }
@@ -21,6 +21,8 @@
 #include "input/loader_desc.h"
 #include "input/stats.h"
 #include "util/macros.h"
+#include <string>
+#include <vector>
 
 namespace viya {
 namespace util {
@@ -44,12 +46,21 @@ public:
 protected:
   BufferLoader(const util::Config &, db::Table &);
 
-private:
-  void LoadTsv();
+  /**
+   * Parses and upserts TSV lines contained in the given buffer. May be called
+   * several times for consecutive parts of the input, as long as every part
+   * ends on a line boundary.
+   */
+  void LoadTsv(const char *buf, size_t buf_size);
 
 protected:
   const char *buf_;
   size_t buf_size_;
+
+private:
+  std::vector<std::string> tuple_;
+  std::vector<char> line_;
+  size_t line_num_;
 };
 } // namespace input
 } // namespace viya
@@ -21,10 +21,33 @@
 namespace viya {
 namespace input {
 
+/**
+ * Upserts the rows loaded into a table into its rollup view
+ */
+class ViewLoader : public Loader {
+public:
+  ViewLoader(const Loader &base, db::Table &view) : Loader(base, view) {}
+
+  void LoadData() {}
+};
+
 Loader::Loader(const util::Config &config, db::Table &table)
     : desc_(config, table), table_(table),
       stats_(table.database().statsd(), table.name()) {
+  Init();
+
+  for (auto view : table.views()) {
+    views_.push_back(std::make_unique<ViewLoader>(*this, *view));
+  }
+}
+
+Loader::Loader(const Loader &base, db::Table &view)
+    : desc_(base.desc_, view), table_(view),
+      stats_(view.database().statsd(), view.name()) {
+  Init();
+}
 
+void Loader::Init() {
   cg::UpsertGenerator upsert_gen(desc_);
 
   before_upsert_ = upsert_gen.BeforeFunction();
@@ -34,9 +57,40 @@ Loader::Loader(const util::Config &config, db::Table &table)
   loader_ctx_ = upsert_gen.SetupFunction()(desc_);
 }
 
-void Loader::BeforeLoad() { before_upsert_(loader_ctx_); }
+util::ScopeGuard Loader::BeforeLoad() {
+  BeginWrite();
+  util::ScopeGuard end_write = [this]() { EndWrite(); };
+  BeforeUpsert();
+  return end_write;
+}
 
-db::UpsertStats Loader::AfterLoad() { return after_upsert_(loader_ctx_); }
+void Loader::BeginWrite() {
+  table_.BeginWrite();
+  for (auto &view : views_) {
+    view->BeginWrite();
+  }
+}
+
+void Loader::EndWrite() {
+  for (auto &view : views_) {
+    view->EndWrite();
+  }
+  table_.EndWrite();
+}
+
+void Loader::BeforeUpsert() {
+  before_upsert_(loader_ctx_);
+  for (auto &view : views_) {
+    view->BeforeUpsert();
+  }
+}
+
+db::UpsertStats Loader::AfterLoad() {
+  for (auto &view : views_) {
+    view->AfterLoad();
+  }
+  return after_upsert_(loader_ctx_);
+}
 
 } // namespace input
 } // namespace viya
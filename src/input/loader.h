@@ -22,6 +22,9 @@
 #include "input/loader_desc.h"
 #include "input/stats.h"
 #include "util/macros.h"
+#include "util/scope_guard.h"
+#include <memory>
+#include <vector>
 
 namespace viya {
 namespace input {
@@ -38,10 +41,31 @@ public:
   const LoaderDesc &desc() const { return desc_; }
 
 protected:
-  void BeforeLoad();
-  void Load(std::vector<std::string> &values) { upsert_(loader_ctx_, values); }
+  /**
+   * Creates a loader that maintains a rollup view of the base loader table
+   */
+  Loader(const Loader &base, db::Table &view);
+
+  /**
+   * Prepares the loader and its views for loading. Their tables are marked as
+   * being written until the returned guard is destroyed, even if the load
+   * fails.
+   */
+  util::ScopeGuard BeforeLoad();
+  void Load(std::vector<std::string> &values) {
+    upsert_(loader_ctx_, values);
+    for (auto &view : views_) {
+      view->Load(values);
+    }
+  }
   db::UpsertStats AfterLoad();
 
+private:
+  void Init();
+  void BeginWrite();
+  void EndWrite();
+  void BeforeUpsert();
+
 protected:
   const LoaderDesc desc_;
   db::Table &table_;
@@ -50,6 +74,7 @@ protected:
   cg::AfterUpsertFn after_upsert_;
   cg::UpsertFn upsert_;
   void *loader_ctx_;
+  std::vector<std::unique_ptr<Loader>> views_;
 };
 
 } // namespace input
@@ -49,24 +49,60 @@ LoaderDesc::LoaderDesc(const util::Config &config, const db::Table &table)
   }
 
   InitTupleIdxMap();
+  InitPartitionIdxMap();
 }
 
-void LoaderDesc::InitTupleIdxMap() {
-  auto columns = table_.columns();
-  auto has_field_mapping =
-      std::find_if(columns.begin(), columns.end(), [](auto col) {
-        return !col->input_field().empty();
-      }) != columns.end();
+LoaderDesc::LoaderDesc(const LoaderDesc &base, const db::Table &view)
+    : config_(base.config_), table_(view), format_(base.format_),
+      fname_(base.fname_), columns_num_(base.columns_num_),
+      partition_idx_map_(base.partition_idx_map_) {
+  if (base.has_partition_filter()) {
+    partition_filter_.reset(
+        new PartitionFilter(config_.sub("partition_filter")));
+  }
+
+  // View columns are read from the same input values as the base columns:
+  auto base_cols = InputColumns(base.table_);
+  for (auto col : InputColumns(view)) {
+    auto it = std::find_if(base_cols.begin(), base_cols.end(), [col](auto c) {
+      return c->name() == col->name();
+    });
+    tuple_idx_map_.push_back(
+        base.tuple_idx_map_[std::distance(base_cols.begin(), it)]);
+  }
+}
 
+std::vector<const db::Column *>
+LoaderDesc::InputColumns(const db::Table &table) {
   std::vector<const db::Column *> input_cols;
-  for (auto dimension : table_.dimensions()) {
+  for (auto dimension : table.dimensions()) {
     input_cols.push_back(dimension);
   }
-  for (auto metric : table_.metrics()) {
+  for (auto metric : table.metrics()) {
     if (metric->agg_type() != db::Metric::AggregationType::COUNT) {
       input_cols.push_back(metric);
     }
   }
+  return input_cols;
+}
+
+void LoaderDesc::InitPartitionIdxMap() {
+  if (partition_filter_) {
+    for (auto &column : partition_filter_->columns()) {
+      partition_idx_map_.push_back(
+          tuple_idx_map_[table_.dimension(column)->index()]);
+    }
+  }
+}
+
+void LoaderDesc::InitTupleIdxMap() {
+  auto columns = table_.columns();
+  auto has_field_mapping =
+      std::find_if(columns.begin(), columns.end(), [](auto col) {
+        return !col->input_field().empty();
+      }) != columns.end();
+
+  auto input_cols = InputColumns(table_);
   tuple_idx_map_.resize(input_cols.size());
 
   if (config_.exists("columns")) {
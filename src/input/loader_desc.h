@@ -19,6 +19,7 @@
 
 #include "util/macros.h"
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace viya {
@@ -63,6 +64,11 @@ public:
   enum Format { TSV, UNKNOWN };
 
   LoaderDesc(const util::Config &config, const db::Table &table);
+
+  /**
+   * Describes loading of the same input into a rollup view of the table
+   */
+  LoaderDesc(const LoaderDesc &base, const db::Table &view);
   DISALLOW_COPY_AND_MOVE(LoaderDesc);
   virtual ~LoaderDesc() = default;
 
@@ -74,9 +80,14 @@ public:
   size_t columns_num() const { return columns_num_; }
   const PartitionFilter &partition_filter() const { return *partition_filter_; }
   bool has_partition_filter() const { return (bool)partition_filter_; }
+  const std::vector<int> &partition_idx_map() const {
+    return partition_idx_map_;
+  }
 
 private:
+  static std::vector<const db::Column *> InputColumns(const db::Table &table);
   void InitTupleIdxMap();
+  void InitPartitionIdxMap();
 
 private:
   const util::Config &config_;
@@ -86,6 +97,7 @@ private:
   std::vector<int> tuple_idx_map_;
   size_t columns_num_;
   std::unique_ptr<PartitionFilter> partition_filter_;
+  std::vector<int> partition_idx_map_;
 };
 } // namespace input
 } // namespace viya
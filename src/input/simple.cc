@@ -27,7 +27,7 @@ SimpleLoader::SimpleLoader(const util::Config &config, db::Table &table)
     : Loader(config, table) {}
 
 void SimpleLoader::Load(std::initializer_list<std::vector<std::string>> rows) {
-  BeforeLoad();
+  auto writing = BeforeLoad();
   for (auto row : rows) {
     Loader::Load(row);
   }
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "input/stream_loader.h"
+#include "db/table.h"
+#include "util/config.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace viya {
+namespace input {
+
+StreamLoader::StreamLoader(const util::Config &config, db::Table &table,
+                           std::istream &stream)
+    : BufferLoader(config, table), stream_(stream),
+      block_(config.num("block_size", 1048576L)) {
+
+  if (block_.empty()) {
+    throw std::invalid_argument("block size must be positive");
+  }
+}
+
+void StreamLoader::LoadTsvStream() {
+  char *block = block_.data();
+  size_t pending = 0;
+
+  while (true) {
+    stream_.read(block + pending, block_.size() - pending);
+    size_t size = pending + stream_.gcount();
+    if (size == 0) {
+      break;
+    }
+
+    if (!stream_) {
+      // The last line may come without a line separator:
+      LoadTsv(block, size);
+      break;
+    }
+
+    const char *last_nl = (const char *)memrchr(block, '\n', size);
+    if (last_nl == nullptr) {
+      throw std::runtime_error("input line is longer than block size (" +
+                               std::to_string(block_.size()) + ")");
+    }
+
+    size_t complete = last_nl - block + 1;
+    LoadTsv(block, complete);
+
+    // Move the trailing partial line to the beginning of the block:
+    pending = size - complete;
+    memmove(block, block + complete, pending);
+  }
+}
+
+void StreamLoader::LoadData() {
+  stats_.OnBegin();
+  auto writing = BeforeLoad();
+
+  if (desc_.format() == LoaderDesc::Format::TSV) {
+    LoadTsvStream();
+  } else {
+    throw std::runtime_error("unknown input format (supported formats: TSV)");
+  }
+
+  stats_.upsert_stats = AfterLoad();
+  stats_.OnEnd();
+}
+} // namespace input
+} // namespace viya
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_INPUT_STREAM_LOADER_H_
+#define VIYA_INPUT_STREAM_LOADER_H_
+
+#include "input/buffer_loader.h"
+#include "util/macros.h"
+#include <istream>
+#include <vector>
+
+namespace viya {
+namespace util {
+class Config;
+}
+} // namespace viya
+
+namespace viya {
+namespace input {
+
+namespace util = viya::util;
+
+/**
+ * Loads records from an input stream. The stream is consumed in blocks of
+ * fixed size, and only complete lines are handed to the parser, so memory
+ * usage doesn't depend on the total amount of data.
+ */
+class StreamLoader : public BufferLoader {
+public:
+  StreamLoader(const util::Config &config, db::Table &table,
+               std::istream &stream);
+  DISALLOW_COPY_AND_MOVE(StreamLoader);
+
+  void LoadData();
+
+private:
+  void LoadTsvStream();
+
+private:
+  std::istream &stream_;
+  std::vector<char> block_;
+};
+} // namespace input
+} // namespace viya
+
+#endif // VIYA_INPUT_STREAM_LOADER_H_
@@ -96,13 +96,14 @@ std::vector<std::string> Watcher::ScanFiles(Watch &watch) {
 void Watcher::ProcessEvent(Watch &watch) {
   for (auto &file : ScanFiles(watch)) {
     if (watch.last_file.empty() || watch.last_file < file) {
-      db_.write_pool().enqueue([=] {
+      auto table_name = watch.table->name();
+      db_.write_scheduler().Enqueue(table_name, [=] {
         try {
           util::Config load_conf;
           load_conf.set_str("type", "file");
           load_conf.set_str("file", file);
           load_conf.set_str("format", "tsv");
-          load_conf.set_str("table", watch.table->name());
+          load_conf.set_str("table", table_name);
           db_.Load(load_conf);
         } catch (std::exception &e) {
           LOG(ERROR) << "Error loading file " << file << ": " << e.what();
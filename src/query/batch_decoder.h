@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_QUERY_BATCH_DECODER_H_
+#define VIYA_QUERY_BATCH_DECODER_H_
+
+#include "db/dictionary.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace viya {
+namespace query {
+
+namespace db = viya::db;
+
+/**
+ * Number of output rows, which dimension values are decoded at once
+ */
+static constexpr size_t DECODE_BATCH_SIZE = 1024;
+
+/**
+ * Decodes string dimension values of a batch of output rows. Rows carry only
+ * value codes until they're output, then the whole batch is decoded under a
+ * single dictionary lock. Every distinct code is copied once per batch, and
+ * rows refer to the decoded values.
+ *
+ * This is used by the generated code, so it's header only.
+ */
+template <typename Code> class BatchDecoder {
+public:
+  BatchDecoder(db::DimensionDict *dict) : dict_(dict), decoded_(0) {
+    codes_.reserve(DECODE_BATCH_SIZE);
+    slots_.reserve(DECODE_BATCH_SIZE);
+  }
+
+  void Add(Code code) { codes_.push_back(code); }
+
+  /**
+   * Decodes all codes added since the last time the batch was cleared
+   */
+  void Decode() {
+    slots_.resize(codes_.size());
+    index_.clear();
+    decoded_ = 0;
+
+    dict_->lock().lock_shared();
+    auto &c2v = dict_->c2v();
+    for (size_t i = 0; i < codes_.size(); ++i) {
+      auto it = index_.emplace(codes_[i], decoded_);
+      if (it.second) {
+        // Strings are reused between batches to keep their capacity:
+        if (decoded_ == values_.size()) {
+          values_.emplace_back();
+        }
+        values_[decoded_++].assign(c2v[codes_[i]]);
+      }
+      slots_[i] = it.first->second;
+    }
+    dict_->lock().unlock_shared();
+  }
+
+  /**
+   * @return decoded value of the row at the given batch position, which
+   *         remains valid until the batch is cleared
+   */
+  std::string_view value(size_t row) const { return values_[slots_[row]]; }
+
+  void Clear() { codes_.clear(); }
+
+private:
+  db::DimensionDict *dict_;
+  std::vector<Code> codes_;
+  std::vector<size_t> slots_;
+  std::vector<std::string> values_;
+  size_t decoded_;
+  std::unordered_map<Code, size_t> index_;
+};
+
+} // namespace query
+} // namespace viya
+
+#endif // VIYA_QUERY_BATCH_DECODER_H_
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "query/cancel.h"
+
+namespace viya {
+namespace query {
+
+static std::string CancelMessage(const std::string &reason,
+                                 const QueryStats &stats) {
+  return "Query cancelled (" + reason + ") after " +
+         std::to_string(
+             cr::duration_cast<cr::milliseconds>(stats.whole_time).count()) +
+         " ms: scanned " + std::to_string(stats.scanned_recs) +
+         " records in " + std::to_string(stats.scanned_segments) +
+         " segments, aggregated " + std::to_string(stats.aggregated_recs) +
+         " records, output " + std::to_string(stats.output_recs) + " records";
+}
+
+QueryCancelled::QueryCancelled(const std::string &reason,
+                               const QueryStats &stats)
+    : std::runtime_error(CancelMessage(reason, stats)), stats_(stats) {}
+
+void Cancellation::Check(const QueryStats &stats) const {
+  // Query that has completed its work is not failed because of a late
+  // cancellation, since its output may have been sent already:
+  if (!stopped_.load()) {
+    return;
+  }
+  auto reason = reason_.load();
+  if (reason != nullptr) {
+    throw QueryCancelled(reason, stats);
+  }
+  if (cr::steady_clock::now() >= deadline_) {
+    throw QueryCancelled("timeout of " + std::to_string(timeout_.count()) +
+                             " ms exceeded",
+                         stats);
+  }
+}
+
+} // namespace query
+} // namespace viya
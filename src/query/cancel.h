@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_QUERY_CANCEL_H_
+#define VIYA_QUERY_CANCEL_H_
+
+#include "query/stats.h"
+#include "util/macros.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+namespace viya {
+namespace query {
+
+namespace cr = std::chrono;
+
+/**
+ * Thrown when a query is cancelled, or when it exceeds its timeout. Statistics
+ * describe the work done until the query has stopped.
+ */
+class QueryCancelled : public std::runtime_error {
+public:
+  QueryCancelled(const std::string &reason, const QueryStats &stats);
+
+  const QueryStats &stats() const { return stats_; }
+
+private:
+  QueryStats stats_;
+};
+
+/**
+ * Cancellation token of a running query. Generated code polls it between
+ * segments and blocks of tuples, and returns early once the query is
+ * cancelled. The query runner then reports the cancellation by throwing
+ * QueryCancelled, unless the query has completed without noticing it.
+ */
+class Cancellation {
+public:
+  Cancellation()
+      : reason_(nullptr), deadline_(cr::steady_clock::time_point::max()),
+        timeout_(0), stopped_(false) {}
+  DISALLOW_COPY_AND_MOVE(Cancellation);
+
+  /**
+   * @param reason static string describing why the query was cancelled
+   */
+  void Cancel(const char *reason) {
+    const char *expected = nullptr;
+    reason_.compare_exchange_strong(expected, reason);
+  }
+
+  /**
+   * Cancels the query once the timeout passes (counting from now)
+   */
+  void SetTimeout(cr::milliseconds timeout) {
+    timeout_ = timeout;
+    deadline_ = cr::steady_clock::now() + timeout;
+  }
+
+  /**
+   * Polled by the query, which stops its work once this returns true
+   */
+  bool cancelled() const {
+    if (reason_.load(std::memory_order_relaxed) != nullptr ||
+        cr::steady_clock::now() >= deadline_) {
+      stopped_.store(true, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @throws QueryCancelled if the query has stopped because of cancellation
+   */
+  void Check(const QueryStats &stats) const;
+
+private:
+  std::atomic<const char *> reason_;
+  cr::steady_clock::time_point deadline_;
+  cr::milliseconds timeout_;
+  mutable std::atomic<bool> stopped_;
+};
+
+} // namespace query
+} // namespace viya
+
+#endif // VIYA_QUERY_CANCEL_H_
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "query/cursor.h"
+#include <sstream>
+
+namespace viya {
+namespace query {
+
+Cursor Cursor::Parse(const std::string &token) {
+  Cursor cursor;
+  cursor.enabled_ = true;
+  if (token.empty()) {
+    return cursor;
+  }
+
+  std::istringstream is(token);
+  char sep1 = 0, sep2 = 0;
+  is >> std::hex >> cursor.layout_version_ >> sep1 >> cursor.segment_ >>
+      sep2 >> cursor.tuple_;
+  if (is.fail() || !is.eof() || sep1 != '.' || sep2 != '.' ||
+      cursor.layout_version_ == 0) {
+    throw std::invalid_argument("Invalid cursor: " + token);
+  }
+  return cursor;
+}
+
+std::string Cursor::ToString() const {
+  std::ostringstream os;
+  os << std::hex << layout_version_ << '.' << segment_ << '.' << tuple_;
+  return os.str();
+}
+
+void Cursor::Bind(uint64_t layout_version) {
+  if (layout_version_ == 0) {
+    layout_version_ = layout_version;
+  } else if (layout_version_ != layout_version) {
+    throw CursorExpired();
+  }
+}
+
+} // namespace query
+} // namespace viya
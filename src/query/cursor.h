@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_QUERY_CURSOR_H_
+#define VIYA_QUERY_CURSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace viya {
+namespace query {
+
+/**
+ * Thrown when a cursor points to segments that don't exist anymore
+ */
+class CursorExpired : public std::runtime_error {
+public:
+  CursorExpired()
+      : std::runtime_error("Cursor has expired, since table segments have "
+                           "changed") {}
+};
+
+/**
+ * Position in table segments, where a page of select query results has
+ * ended. The next page is scanned starting from this position, instead of
+ * skipping all the rows of previous pages.
+ *
+ * Positions are only meaningful for the segments layout they were taken
+ * from, therefore a cursor also keeps the layout version.
+ */
+class Cursor {
+public:
+  Cursor()
+      : enabled_(false), layout_version_(0), segment_(0), tuple_(0),
+        more_(false) {}
+
+  /**
+   * Parses a cursor returned with the previous page. Empty string stands for
+   * the first page.
+   */
+  static Cursor Parse(const std::string &token);
+
+  /**
+   * @return opaque string, which is passed to the query for the next page
+   */
+  std::string ToString() const;
+
+  bool enabled() const { return enabled_; }
+  size_t segment() const { return segment_; }
+  size_t tuple() const { return tuple_; }
+
+  /**
+   * Binds the cursor to the current segments layout
+   *
+   * @throws CursorExpired if the cursor was taken from a different layout
+   */
+  void Bind(uint64_t layout_version);
+
+  /**
+   * Called by the generated code when a page is full
+   *
+   * @param segment index of the segment to continue from
+   * @param tuple index of the first tuple of the next page in that segment
+   */
+  void Stop(size_t segment, size_t tuple) {
+    segment_ = segment;
+    tuple_ = tuple;
+    more_ = true;
+  }
+
+  /**
+   * @return whether the query has stopped before scanning all the segments
+   */
+  bool more() const { return more_; }
+
+private:
+  bool enabled_;
+  uint64_t layout_version_;
+  size_t segment_;
+  size_t tuple_;
+  bool more_;
+};
+
+} // namespace query
+} // namespace viya
+
+#endif // VIYA_QUERY_CURSOR_H_
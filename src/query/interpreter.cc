@@ -0,0 +1,962 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "query/interpreter.h"
+#include "db/column.h"
+#include "db/dictionary.h"
+#include "db/segment.h"
+#include "db/store.h"
+#include "db/table.h"
+#include "util/format.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace viya {
+namespace query {
+
+namespace {
+
+const size_t BLOCK_SIZE = 1024;
+
+enum class NumKind {
+  INT8,
+  UINT8,
+  INT16,
+  UINT16,
+  INT32,
+  UINT32,
+  INT64,
+  UINT64,
+  FLOAT,
+  DOUBLE
+};
+
+NumKind KindOf(const db::Column *column) {
+  static const std::unordered_map<std::string, NumKind> kinds = {
+      {"int8_t", NumKind::INT8},     {"uint8_t", NumKind::UINT8},
+      {"int16_t", NumKind::INT16},   {"uint16_t", NumKind::UINT16},
+      {"int32_t", NumKind::INT32},   {"uint32_t", NumKind::UINT32},
+      {"int64_t", NumKind::INT64},   {"uint64_t", NumKind::UINT64},
+      {"float", NumKind::FLOAT},     {"double", NumKind::DOUBLE}};
+  return kinds.at(column->num_type().cpp_type());
+}
+
+/**
+ * Calls the function with a value of the native type that corresponds to the
+ * given kind, so that the function can operate on typed column data.
+ */
+template <typename F> void Dispatch(NumKind kind, F &&f) {
+  switch (kind) {
+  case NumKind::INT8:
+    f(int8_t());
+    break;
+  case NumKind::UINT8:
+    f(uint8_t());
+    break;
+  case NumKind::INT16:
+    f(int16_t());
+    break;
+  case NumKind::UINT16:
+    f(uint16_t());
+    break;
+  case NumKind::INT32:
+    f(int32_t());
+    break;
+  case NumKind::UINT32:
+    f(uint32_t());
+    break;
+  case NumKind::INT64:
+    f(int64_t());
+    break;
+  case NumKind::UINT64:
+    f(uint64_t());
+    break;
+  case NumKind::FLOAT:
+    f(float());
+    break;
+  case NumKind::DOUBLE:
+    f(double());
+    break;
+  }
+}
+
+/**
+ * Extracts filter argument of the given type. Narrow signed values are kept
+ * by AnyNum as 32 bit integers.
+ */
+template <typename T> T ArgValue(db::AnyNum arg) {
+  if constexpr (std::is_same<T, int8_t>::value ||
+                std::is_same<T, int16_t>::value ||
+                std::is_same<T, int32_t>::value) {
+    return static_cast<T>(arg.get_int32_t());
+  } else if constexpr (std::is_same<T, uint8_t>::value) {
+    return arg.get_uint8_t();
+  } else if constexpr (std::is_same<T, uint16_t>::value) {
+    return arg.get_uint16_t();
+  } else if constexpr (std::is_same<T, uint32_t>::value) {
+    return arg.get_uint32_t();
+  } else if constexpr (std::is_same<T, int64_t>::value) {
+    return arg.get_int64_t();
+  } else if constexpr (std::is_same<T, uint64_t>::value) {
+    return arg.get_uint64_t();
+  } else if constexpr (std::is_same<T, float>::value) {
+    return static_cast<float>(arg.get_float());
+  } else {
+    return arg.get_double();
+  }
+}
+
+uint64_t CodeAt(NumKind kind, const void *data, size_t idx) {
+  uint64_t code = 0;
+  Dispatch(kind, [&](auto t) {
+    using T = decltype(t);
+    code = static_cast<uint64_t>(static_cast<const T *>(data)[idx]);
+  });
+  return code;
+}
+
+/**
+ * Position of a column in the list returned by db::SegmentBase::columns()
+ */
+size_t ColumnSlot(const db::Table &table, const db::Column *column) {
+  return column->type() == db::Column::Type::DIMENSION
+             ? column->index()
+             : table.dimensions().size() + column->index();
+}
+
+bool IsBitset(const db::Column *column) {
+  return column->type() == db::Column::Type::METRIC &&
+         static_cast<const db::Metric *>(column)->agg_type() ==
+             db::Metric::AggregationType::BITSET;
+}
+
+bool IsTime(const db::Column *column) {
+  return column->type() == db::Column::Type::DIMENSION &&
+         static_cast<const db::Dimension *>(column)->dim_type() ==
+             db::Dimension::DimType::TIME;
+}
+
+/**
+ * Filter predicate, which is evaluated on a block of column values at once
+ */
+class Predicate {
+public:
+  virtual ~Predicate() {}
+
+  /**
+   * Sets mask[i] to whether the predicate holds for the row (start + i)
+   */
+  virtual void Eval(const std::vector<void *> &columns, size_t start,
+                    size_t size, uint8_t *mask) const = 0;
+};
+
+template <typename T> class RelOpPredicate : public Predicate {
+public:
+  RelOpPredicate(size_t slot, RelOpFilter::Operator op, T value)
+      : slot_(slot), op_(op), value_(value) {}
+
+  void Eval(const std::vector<void *> &columns, size_t start, size_t size,
+            uint8_t *mask) const {
+    const T *col = static_cast<const T *>(columns[slot_]) + start;
+    switch (op_) {
+    case RelOpFilter::Operator::EQUAL:
+      for (size_t i = 0; i < size; ++i) {
+        mask[i] = col[i] == value_;
+      }
+      break;
+    case RelOpFilter::Operator::NOT_EQUAL:
+      for (size_t i = 0; i < size; ++i) {
+        mask[i] = col[i] != value_;
+      }
+      break;
+    case RelOpFilter::Operator::LESS:
+      for (size_t i = 0; i < size; ++i) {
+        mask[i] = col[i] < value_;
+      }
+      break;
+    case RelOpFilter::Operator::LESS_EQUAL:
+      for (size_t i = 0; i < size; ++i) {
+        mask[i] = col[i] <= value_;
+      }
+      break;
+    case RelOpFilter::Operator::GREATER:
+      for (size_t i = 0; i < size; ++i) {
+        mask[i] = col[i] > value_;
+      }
+      break;
+    case RelOpFilter::Operator::GREATER_EQUAL:
+      for (size_t i = 0; i < size; ++i) {
+        mask[i] = col[i] >= value_;
+      }
+      break;
+    }
+  }
+
+private:
+  const size_t slot_;
+  const RelOpFilter::Operator op_;
+  const T value_;
+};
+
+template <typename T> class InPredicate : public Predicate {
+public:
+  InPredicate(size_t slot, const std::vector<T> &values, bool equal)
+      : slot_(slot), values_(values), equal_(equal) {}
+
+  void Eval(const std::vector<void *> &columns, size_t start, size_t size,
+            uint8_t *mask) const {
+    const T *col = static_cast<const T *>(columns[slot_]) + start;
+    std::memset(mask, equal_ ? 0 : 1, size);
+    for (auto value : values_) {
+      if (equal_) {
+        for (size_t i = 0; i < size; ++i) {
+          mask[i] |= col[i] == value;
+        }
+      } else {
+        for (size_t i = 0; i < size; ++i) {
+          mask[i] &= col[i] != value;
+        }
+      }
+    }
+  }
+
+private:
+  const size_t slot_;
+  const std::vector<T> values_;
+  const bool equal_;
+};
+
+class CompositePredicate : public Predicate {
+public:
+  CompositePredicate(CompositeFilter::Operator op,
+                     std::vector<std::unique_ptr<Predicate>> &&predicates)
+      : op_(op), predicates_(std::move(predicates)) {}
+
+  void Eval(const std::vector<void *> &columns, size_t start, size_t size,
+            uint8_t *mask) const {
+    std::memset(mask, op_ == CompositeFilter::Operator::AND ? 1 : 0, size);
+    uint8_t other[BLOCK_SIZE];
+    for (auto &predicate : predicates_) {
+      predicate->Eval(columns, start, size, other);
+      if (op_ == CompositeFilter::Operator::AND) {
+        for (size_t i = 0; i < size; ++i) {
+          mask[i] &= other[i];
+        }
+      } else {
+        for (size_t i = 0; i < size; ++i) {
+          mask[i] |= other[i];
+        }
+      }
+    }
+  }
+
+private:
+  const CompositeFilter::Operator op_;
+  const std::vector<std::unique_ptr<Predicate>> predicates_;
+};
+
+class TruePredicate : public Predicate {
+public:
+  void Eval(const std::vector<void *> &columns __attribute__((unused)),
+            size_t start __attribute__((unused)), size_t size,
+            uint8_t *mask) const {
+    std::memset(mask, 1, size);
+  }
+};
+
+/**
+ * Builds predicate from a filter, consuming filter arguments in the same
+ * order they were packed by codegen::FilterArgsPacker.
+ */
+class PredicateBuilder : public FilterVisitor {
+public:
+  PredicateBuilder(const db::Table &table, const std::vector<db::AnyNum> &args)
+      : table_(table), args_(args), argidx_(0) {}
+
+  std::unique_ptr<Predicate> &predicate() { return predicate_; }
+
+  void Visit(const RelOpFilter *filter) {
+    auto column = table_.column(filter->column());
+    auto slot = ColumnSlot(table_, column);
+    auto arg = args_[argidx_++];
+    Dispatch(KindOf(column), [&](auto t) {
+      using T = decltype(t);
+      predicate_.reset(
+          new RelOpPredicate<T>(slot, filter->op(), ArgValue<T>(arg)));
+    });
+  }
+
+  void Visit(const InFilter *filter) {
+    auto column = table_.column(filter->column());
+    auto slot = ColumnSlot(table_, column);
+    Dispatch(KindOf(column), [&](auto t) {
+      using T = decltype(t);
+      std::vector<T> values;
+      for (size_t i = 0; i < filter->values().size(); ++i) {
+        values.push_back(ArgValue<T>(args_[argidx_++]));
+      }
+      predicate_.reset(new InPredicate<T>(slot, values, filter->equal()));
+    });
+  }
+
+  void Visit(const CompositeFilter *filter) {
+    std::vector<std::unique_ptr<Predicate>> predicates;
+    for (auto f : filter->filters()) {
+      f->Accept(*this);
+      predicates.push_back(std::move(predicate_));
+    }
+    predicate_.reset(
+        new CompositePredicate(filter->op(), std::move(predicates)));
+  }
+
+  void Visit(const EmptyFilter *filter __attribute__((unused))) {
+    predicate_.reset(new TruePredicate());
+  }
+
+private:
+  const db::Table &table_;
+  const std::vector<db::AnyNum> &args_;
+  size_t argidx_;
+  std::unique_ptr<Predicate> predicate_;
+};
+
+std::unique_ptr<Predicate> BuildPredicate(const db::Table &table,
+                                          const Filter *filter,
+                                          const std::vector<db::AnyNum> &args) {
+  PredicateBuilder builder(table, args);
+  filter->Accept(builder);
+  return std::move(builder.predicate());
+}
+
+/**
+ * Runs the predicate on all table segments, and passes indices of matching
+ * tuples to the consumer block by block. The consumer returns false to stop
+ * the scan. The scan also stops once the query is cancelled.
+ */
+void Scan(db::Table &table, const Predicate &predicate, QueryStats &stats,
+          const Cancellation &cancellation,
+          const std::function<bool(const std::vector<void *> &columns,
+                                   const size_t *sel, size_t sel_size)>
+              &consumer) {
+  uint8_t mask[BLOCK_SIZE];
+  size_t sel[BLOCK_SIZE];
+  for (auto *segment : table.store()->segments_copy()) {
+    if (cancellation.cancelled()) {
+      return;
+    }
+    auto segment_size = segment->size();
+    stats.scanned_recs += segment_size;
+    stats.scanned_segments++;
+
+    auto columns = segment->columns();
+    for (size_t block_start = 0; block_start < segment_size;
+         block_start += BLOCK_SIZE) {
+      if (cancellation.cancelled()) {
+        return;
+      }
+      size_t block_size = std::min(segment_size - block_start, BLOCK_SIZE);
+      predicate.Eval(columns, block_start, block_size, mask);
+
+      size_t sel_size = 0;
+      for (size_t i = 0; i < block_size; ++i) {
+        sel[sel_size] = block_start + i;
+        sel_size += mask[i];
+      }
+      if (sel_size > 0 && !consumer(columns, sel, sel_size)) {
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * Converts dimension value to string the same way generated code does
+ */
+std::string FormatDim(const db::Dimension *dim, const std::string &format,
+                      const void *data, size_t idx, util::Format &fmt) {
+  auto kind = KindOf(dim);
+  switch (dim->dim_type()) {
+  case db::Dimension::DimType::STRING: {
+    auto dict = static_cast<const db::StrDimension *>(dim)->dict();
+    dict->lock().lock_shared();
+    std::string value = dict->c2v()[CodeAt(kind, data, idx)];
+    dict->lock().unlock_shared();
+    return value;
+  }
+  case db::Dimension::DimType::BOOLEAN:
+    return CodeAt(kind, data, idx) ? "true" : "false";
+  case db::Dimension::DimType::TIME:
+    if (!format.empty()) {
+      return fmt.date(format.c_str(), (uint32_t)CodeAt(kind, data, idx));
+    }
+    break;
+  default:
+    break;
+  }
+  std::string value;
+  Dispatch(kind, [&](auto t) {
+    using T = decltype(t);
+    value = fmt.num(static_cast<const T *>(data)[idx]);
+  });
+  return value;
+}
+
+/**
+ * Converts metric value to string. Average metric values are divided by the
+ * count value.
+ */
+std::string FormatMetric(const db::Metric *metric, const void *data,
+                         size_t idx, NumKind count_kind,
+                         const void *count_data, util::Format &fmt) {
+  std::string value;
+  Dispatch(KindOf(metric), [&](auto t) {
+    using T = decltype(t);
+    auto v = static_cast<const T *>(data)[idx];
+    if (metric->agg_type() == db::Metric::AggregationType::AVG) {
+      Dispatch(count_kind, [&](auto c) {
+        using C = decltype(c);
+        value = fmt.num(v / (double)static_cast<const C *>(count_data)[idx]);
+      });
+    } else {
+      value = fmt.num(v);
+    }
+  });
+  return value;
+}
+
+/**
+ * Finds the query metric to divide by when calculating averages. If the
+ * query doesn't contain a count metric, the special count column is used.
+ */
+const db::Metric *CountMetric(const SelectQuery *query) {
+  for (auto &metric_col : query->metric_cols()) {
+    if (metric_col.metric()->agg_type() == db::Metric::AggregationType::COUNT) {
+      return metric_col.metric();
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Whether averages of the query can be calculated: the special count column
+ * only exists when the table has no count metric.
+ */
+bool AverageSupported(SelectQuery *query) {
+  bool has_avg = std::any_of(
+      query->metric_cols().begin(), query->metric_cols().end(),
+      [](const MetricOutputColumn &metric_col) {
+        return metric_col.metric()->agg_type() ==
+               db::Metric::AggregationType::AVG;
+      });
+  if (!has_avg || CountMetric(query) != nullptr) {
+    return true;
+  }
+  auto &metrics = query->table().metrics();
+  return std::none_of(metrics.begin(), metrics.end(),
+                      [](const db::Metric *metric) {
+                        return metric->agg_type() ==
+                               db::Metric::AggregationType::COUNT;
+                      });
+}
+
+bool FilterSupported(const db::Table &table, const Filter *filter,
+                     const std::function<bool(const db::Column *)> &check) {
+  ColumnsCollector collector;
+  filter->Accept(collector);
+  for (auto &name : collector.columns()) {
+    if (!check(table.column(name))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SendHeader(SelectQuery *query, RowOutput &output,
+                RowOutput::Row &row) {
+  if (query->header()) {
+    for (auto &dim_col : query->dimension_cols()) {
+      row[dim_col.index()] = dim_col.dim()->name();
+    }
+    for (auto &metric_col : query->metric_cols()) {
+      row[metric_col.index()] = metric_col.metric()->name();
+    }
+    output.Send(row);
+  }
+}
+
+/**
+ * Column of aggregated values, which are stored in their native type
+ */
+class ResultColumn {
+public:
+  ResultColumn(NumKind kind, size_t width) : kind_(kind), width_(width) {}
+
+  NumKind kind() const { return kind_; }
+  size_t width() const { return width_; }
+  void *data() { return data_.data(); }
+
+  void Append(const void *value) {
+    auto bytes = static_cast<const char *>(value);
+    data_.insert(data_.end(), bytes, bytes + width_);
+  }
+
+private:
+  NumKind kind_;
+  size_t width_;
+  std::vector<char> data_;
+};
+
+} // namespace
+
+bool Interpreter::Supports(SelectQuery *query) {
+  // Cursors are only supported by the generated code:
+  if (query->cursor().enabled()) {
+    return false;
+  }
+  auto &table = query->table();
+  for (auto &metric_col : query->metric_cols()) {
+    if (IsBitset(metric_col.metric())) {
+      return false;
+    }
+  }
+  return AverageSupported(query) &&
+         FilterSupported(table, query->filter(), [](const db::Column *col) {
+           return !IsBitset(col);
+         });
+}
+
+bool Interpreter::Supports(AggregateQuery *query) {
+  if (!Supports(static_cast<SelectQuery *>(query))) {
+    return false;
+  }
+  // Sampled queries are only supported by the generated code:
+  if (query->sample().enabled()) {
+    return false;
+  }
+  // Time values that must be rolled up are left for the generated code:
+  for (auto &dim_col : query->dimension_cols()) {
+    if (IsTime(dim_col.dim()) &&
+        (!static_cast<const db::TimeDimension *>(dim_col.dim())
+              ->rollup_rules()
+              .empty() ||
+         !dim_col.granularity().empty())) {
+      return false;
+    }
+  }
+  for (auto &sort_col : query->sort_cols()) {
+    if (IsTime(sort_col.col()) || IsBitset(sort_col.col())) {
+      return false;
+    }
+  }
+  if (query->having() != nullptr) {
+    // HAVING filter is evaluated on aggregated output columns:
+    auto columns = query->column_names();
+    return FilterSupported(
+        query->table(), query->having(), [&](const db::Column *col) {
+          return !IsBitset(col) && std::find(columns.begin(), columns.end(),
+                                             col->name()) != columns.end();
+        });
+  }
+  return true;
+}
+
+bool Interpreter::Supports(SearchQuery *query) {
+  return FilterSupported(query->table(), query->filter(),
+                         [](const db::Column *col) { return !IsBitset(col); });
+}
+
+void Interpreter::Visit(SelectQuery *query) {
+  auto &table = query->table();
+  auto filter = BuildPredicate(table, query->filter(), fargs_);
+
+  auto count_metric = CountMetric(query);
+  auto count_slot = count_metric != nullptr ? ColumnSlot(table, count_metric)
+                                            : table.dimensions().size() +
+                                                  table.metrics().size();
+  auto count_kind = count_metric != nullptr ? KindOf(count_metric)
+                                            : NumKind::UINT64;
+
+  RowOutput::Row row(query->dimension_cols().size() +
+                     query->metric_cols().size());
+  util::Format fmt;
+  size_t skip = query->skip();
+  size_t limit = query->limit();
+  size_t row_index = 0;
+
+  output_.Start();
+  SendHeader(query, output_, row);
+
+  Scan(table, *filter, stats_, cancellation_,
+       [&](const std::vector<void *> &columns, const size_t *sel,
+           size_t sel_size) {
+         for (size_t sel_idx = 0; sel_idx < sel_size; ++sel_idx) {
+           size_t tuple_idx = sel[sel_idx];
+           if (skip > 0 && row_index++ < skip) {
+             continue;
+           }
+           for (auto &dim_col : query->dimension_cols()) {
+             auto dim = dim_col.dim();
+             row[dim_col.index()] = FormatDim(dim, dim_col.format(),
+                                              columns[ColumnSlot(table, dim)],
+                                              tuple_idx, fmt);
+           }
+           for (auto &metric_col : query->metric_cols()) {
+             auto metric = metric_col.metric();
+             row[metric_col.index()] = FormatMetric(
+                 metric, columns[ColumnSlot(table, metric)], tuple_idx,
+                 count_kind,
+                 metric->agg_type() == db::Metric::AggregationType::AVG
+                     ? columns[count_slot]
+                     : nullptr,
+                 fmt);
+           }
+           output_.Send(row);
+           ++stats_.output_recs;
+           if (limit > 0 && stats_.output_recs >= limit) {
+             return false;
+           }
+         }
+         return true;
+       });
+  if (cancellation_.cancelled()) {
+    return;
+  }
+
+  output_.Flush();
+}
+
+void Interpreter::Visit(AggregateQuery *query) {
+  auto &table = query->table();
+  auto filter = BuildPredicate(table, query->filter(), fargs_);
+  auto &dim_cols = query->dimension_cols();
+  auto &metric_cols = query->metric_cols();
+
+  // Aggregated values of every output column:
+  std::vector<ResultColumn> dims;
+  for (auto &dim_col : dim_cols) {
+    dims.emplace_back(KindOf(dim_col.dim()), dim_col.dim()->num_type().size());
+  }
+  std::vector<ResultColumn> metrics;
+  std::vector<uint64_t> initial_values(metric_cols.size(), 0);
+  for (size_t i = 0; i < metric_cols.size(); ++i) {
+    auto metric = metric_cols[i].metric();
+    auto kind = KindOf(metric);
+    metrics.emplace_back(kind, metric->num_type().size());
+    Dispatch(kind, [&](auto t) {
+      using T = decltype(t);
+      T value = 0;
+      if (metric->agg_type() == db::Metric::AggregationType::MAX) {
+        value = std::numeric_limits<T>::min();
+      } else if (metric->agg_type() == db::Metric::AggregationType::MIN) {
+        value = std::numeric_limits<T>::max();
+      }
+      std::memcpy(&initial_values[i], &value, sizeof(value));
+    });
+  }
+
+  // Special count column for calculating averages:
+  auto count_metric = CountMetric(query);
+  bool has_avg = std::any_of(
+      metric_cols.begin(), metric_cols.end(),
+      [](const MetricOutputColumn &metric_col) {
+        return metric_col.metric()->agg_type() ==
+               db::Metric::AggregationType::AVG;
+      });
+  bool special_count = has_avg && count_metric == nullptr;
+  ResultColumn counts(NumKind::UINT64, sizeof(uint64_t));
+  size_t special_count_slot =
+      table.dimensions().size() + table.metrics().size();
+
+  std::unordered_map<std::string, size_t> groups;
+  std::string key;
+  std::vector<size_t> group_ids(BLOCK_SIZE);
+
+  Scan(table, *filter, stats_, cancellation_,
+       [&](const std::vector<void *> &columns, const size_t *sel,
+           size_t sel_size) {
+         // Find group of every selected tuple:
+         for (size_t sel_idx = 0; sel_idx < sel_size; ++sel_idx) {
+           key.clear();
+           for (size_t i = 0; i < dim_cols.size(); ++i) {
+             auto data = static_cast<const char *>(
+                 columns[ColumnSlot(table, dim_cols[i].dim())]);
+             key.append(data + sel[sel_idx] * dims[i].width(),
+                        dims[i].width());
+           }
+           auto it = groups.emplace(key, groups.size());
+           if (it.second) {
+             size_t offset = 0;
+             for (auto &dim : dims) {
+               dim.Append(key.data() + offset);
+               offset += dim.width();
+             }
+             for (size_t i = 0; i < metrics.size(); ++i) {
+               metrics[i].Append(&initial_values[i]);
+             }
+             uint64_t zero = 0;
+             counts.Append(&zero);
+           }
+           group_ids[sel_idx] = it.first->second;
+         }
+
+         // Update aggregated metrics column by column:
+         for (size_t i = 0; i < metric_cols.size(); ++i) {
+           auto metric = metric_cols[i].metric();
+           Dispatch(metrics[i].kind(), [&](auto t) {
+             using T = decltype(t);
+             auto src =
+                 static_cast<const T *>(columns[ColumnSlot(table, metric)]);
+             auto dst = static_cast<T *>(metrics[i].data());
+             switch (metric->agg_type()) {
+             case db::Metric::AggregationType::MAX:
+               for (size_t k = 0; k < sel_size; ++k) {
+                 dst[group_ids[k]] = std::max(dst[group_ids[k]], src[sel[k]]);
+               }
+               break;
+             case db::Metric::AggregationType::MIN:
+               for (size_t k = 0; k < sel_size; ++k) {
+                 dst[group_ids[k]] = std::min(dst[group_ids[k]], src[sel[k]]);
+               }
+               break;
+             default:
+               for (size_t k = 0; k < sel_size; ++k) {
+                 dst[group_ids[k]] += src[sel[k]];
+               }
+               break;
+             }
+           });
+         }
+         if (special_count) {
+           auto src =
+               static_cast<const uint64_t *>(columns[special_count_slot]);
+           auto dst = static_cast<uint64_t *>(counts.data());
+           for (size_t k = 0; k < sel_size; ++k) {
+             dst[group_ids[k]] += src[sel[k]];
+           }
+         }
+         return true;
+       });
+
+  stats_.aggregated_recs = groups.size();
+  if (cancellation_.cancelled()) {
+    return;
+  }
+  size_t groups_num = groups.size();
+  groups.clear();
+
+  // Result columns are laid out like segment columns, so that HAVING filter
+  // can be evaluated on them:
+  std::vector<void *> result_columns(special_count_slot + 1, nullptr);
+  for (size_t i = 0; i < dims.size(); ++i) {
+    result_columns[ColumnSlot(table, dim_cols[i].dim())] = dims[i].data();
+  }
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    result_columns[ColumnSlot(table, metric_cols[i].metric())] =
+        metrics[i].data();
+  }
+  result_columns[special_count_slot] = counts.data();
+
+  std::vector<uint8_t> passed(groups_num, 1);
+  if (query->having() != nullptr) {
+    auto having = BuildPredicate(table, query->having(), hargs_);
+    for (size_t start = 0; start < groups_num; start += BLOCK_SIZE) {
+      having->Eval(result_columns, start,
+                   std::min(groups_num - start, BLOCK_SIZE), &passed[start]);
+    }
+  }
+
+  auto count_kind =
+      count_metric != nullptr ? KindOf(count_metric) : NumKind::UINT64;
+  void *count_data = count_metric != nullptr
+                         ? result_columns[ColumnSlot(table, count_metric)]
+                         : counts.data();
+
+  RowOutput::Row row(dim_cols.size() + metric_cols.size());
+  util::Format fmt;
+  auto send_row = [&](size_t group) {
+    for (size_t i = 0; i < dims.size(); ++i) {
+      row[dim_cols[i].index()] = FormatDim(
+          dim_cols[i].dim(), dim_cols[i].format(), dims[i].data(), group, fmt);
+    }
+    for (size_t i = 0; i < metrics.size(); ++i) {
+      row[metric_cols[i].index()] =
+          FormatMetric(metric_cols[i].metric(), metrics[i].data(), group,
+                       count_kind, count_data, fmt);
+    }
+    output_.Send(row);
+    ++stats_.output_recs;
+  };
+
+  output_.Start();
+
+  size_t skip = std::min(groups_num, query->skip());
+  size_t limit = std::min(query->limit(), groups_num - skip);
+
+  SendHeader(query, output_, row);
+
+  if (query->sort_cols().empty()) {
+    // Skip and limit apply before the HAVING filter, like in generated code:
+    size_t end = limit > 0 ? skip + limit : groups_num;
+    for (size_t group = skip; group < end; ++group) {
+      if (passed[group]) {
+        send_row(group);
+      }
+    }
+    output_.Flush();
+    return;
+  }
+
+  // Build comparator for sorting groups, which returns negative value if the
+  // first group goes before the second one:
+  std::vector<std::function<int(size_t, size_t)>> comparators;
+  std::vector<db::DimensionDict *> dicts;
+  for (auto &sort_col : query->sort_cols()) {
+    auto col = sort_col.col();
+    int sign = sort_col.ascending() ? 1 : -1;
+    auto data = result_columns[ColumnSlot(table, col)];
+
+    if (col->type() == db::Column::Type::DIMENSION &&
+        static_cast<const db::Dimension *>(col)->dim_type() ==
+            db::Dimension::DimType::STRING) {
+      auto dict = static_cast<const db::StrDimension *>(col)->dict();
+      dicts.push_back(dict);
+      Dispatch(KindOf(col), [&](auto t) {
+        using T = decltype(t);
+        auto codes = static_cast<const T *>(data);
+        auto &c2v = dict->c2v();
+        comparators.push_back([=, &c2v](size_t a, size_t b) {
+          return sign * c2v[codes[a]].compare(c2v[codes[b]]);
+        });
+      });
+    } else if (col->type() == db::Column::Type::METRIC &&
+               static_cast<const db::Metric *>(col)->agg_type() ==
+                   db::Metric::AggregationType::AVG) {
+      std::vector<double> averages(groups_num);
+      Dispatch(KindOf(col), [&](auto t) {
+        using T = decltype(t);
+        auto values = static_cast<const T *>(data);
+        Dispatch(count_kind, [&](auto c) {
+          using C = decltype(c);
+          auto count_values = static_cast<const C *>(count_data);
+          for (size_t group = 0; group < groups_num; ++group) {
+            averages[group] = values[group] / (double)count_values[group];
+          }
+        });
+      });
+      comparators.push_back([=](size_t a, size_t b) {
+        return sign *
+               ((averages[a] > averages[b]) - (averages[a] < averages[b]));
+      });
+    } else {
+      Dispatch(KindOf(col), [&](auto t) {
+        using T = decltype(t);
+        auto values = static_cast<const T *>(data);
+        comparators.push_back([=](size_t a, size_t b) {
+          return sign * ((values[a] > values[b]) - (values[a] < values[b]));
+        });
+      });
+    }
+  }
+  auto cmp = [&](size_t a, size_t b) {
+    for (auto &comparator : comparators) {
+      int r = comparator(a, b);
+      if (r != 0) {
+        return r < 0;
+      }
+    }
+    return false;
+  };
+
+  std::vector<size_t> sorted;
+  for (size_t group = 0; group < groups_num; ++group) {
+    if (passed[group]) {
+      sorted.push_back(group);
+    }
+  }
+
+  for (auto dict : dicts) {
+    dict->lock().lock_shared();
+  }
+  size_t sorted_end = limit > 0 ? std::min(sorted.size(), skip + limit)
+                                : sorted.size();
+  std::partial_sort(sorted.begin(), sorted.begin() + sorted_end, sorted.end(),
+                    cmp);
+  for (auto dict : dicts) {
+    dict->lock().unlock_shared();
+  }
+
+  for (size_t sorted_idx = skip; sorted_idx < sorted_end; ++sorted_idx) {
+    send_row(sorted[sorted_idx]);
+  }
+  output_.Flush();
+}
+
+void Interpreter::Visit(SearchQuery *query) {
+  auto &table = query->table();
+  auto filter = BuildPredicate(table, query->filter(), fargs_);
+  auto dim = query->dimension();
+  auto dim_slot = ColumnSlot(table, dim);
+  auto dim_width = dim->num_type().size();
+  size_t limit = query->limit();
+
+  std::unordered_set<uint64_t> codes;
+  std::vector<std::string> values;
+  util::Format fmt;
+
+  Scan(table, *filter, stats_, cancellation_,
+       [&](const std::vector<void *> &columns, const size_t *sel,
+           size_t sel_size) {
+         auto data = static_cast<const char *>(columns[dim_slot]);
+         for (size_t sel_idx = 0; sel_idx < sel_size; ++sel_idx) {
+           uint64_t code = 0;
+           std::memcpy(&code, data + sel[sel_idx] * dim_width, dim_width);
+           if (codes.insert(code).second) {
+             auto check_value =
+                 FormatDim(dim, std::string(), data, sel[sel_idx], fmt);
+             if (check_value.find(query->term()) != std::string::npos) {
+               values.push_back(check_value);
+               if (limit > 0 && values.size() >= limit) {
+                 return false;
+               }
+             }
+           }
+         }
+         return true;
+       });
+
+  stats_.aggregated_recs = codes.size();
+  if (cancellation_.cancelled()) {
+    return;
+  }
+
+  output_.Start();
+  if (query->header()) {
+    output_.Send(std::vector<std::string>{dim->name()});
+  }
+  output_.SendAsCol(values);
+  stats_.output_recs = values.size();
+  output_.Flush();
+}
+
+} // namespace query
+} // namespace viya
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_QUERY_INTERPRETER_H_
+#define VIYA_QUERY_INTERPRETER_H_
+
+#include "query/cancel.h"
+#include "query/output.h"
+#include "query/query.h"
+#include "query/stats.h"
+#include <vector>
+
+namespace viya {
+namespace query {
+
+namespace db = viya::db;
+
+/**
+ * Executes queries directly on segment columns, without generating code.
+ * This is much slower than running a compiled query, but it allows answering
+ * a query immediately, while its code is being compiled in background.
+ *
+ * Only a subset of queries is supported: see Supports().
+ */
+class Interpreter : public QueryVisitor {
+public:
+  Interpreter(RowOutput &output, QueryStats &stats,
+              const Cancellation &cancellation,
+              const std::vector<db::AnyNum> &fargs,
+              const std::vector<db::AnyNum> &hargs = {})
+      : output_(output), stats_(stats), cancellation_(cancellation),
+        fargs_(fargs), hargs_(hargs) {}
+
+  static bool Supports(SelectQuery *query);
+  static bool Supports(AggregateQuery *query);
+  static bool Supports(SearchQuery *query);
+
+  void Visit(SelectQuery *query) override;
+  void Visit(AggregateQuery *query) override;
+  void Visit(SearchQuery *query) override;
+
+private:
+  RowOutput &output_;
+  QueryStats &stats_;
+  const Cancellation &cancellation_;
+  const std::vector<db::AnyNum> fargs_;
+  const std::vector<db::AnyNum> hargs_;
+};
+
+} // namespace query
+} // namespace viya
+
+#endif // VIYA_QUERY_INTERPRETER_H_
@@ -17,7 +17,9 @@
 #ifndef VIYA_QUERY_OUTPUT_H_
 #define VIYA_QUERY_OUTPUT_H_
 
+#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace viya {
@@ -26,24 +28,58 @@ namespace query {
 class RowOutput {
 public:
   using Row = std::vector<std::string>;
+  using RowView = std::vector<std::string_view>;
 
   RowOutput() {}
   virtual ~RowOutput() {}
 
+  /**
+   * Adds a header describing the result. Headers must be added before the
+   * output is started, and outputs that have no notion of headers ignore
+   * them.
+   */
+  virtual void AddHeader(const std::string &name __attribute__((unused)),
+                         const std::string &value __attribute__((unused))) {}
+
   virtual void Start(){};
   virtual void Send(const Row &row) = 0;
   virtual void SendAsCol(const Row &col) = 0;
+
+  /**
+   * Sends a row, which values are owned by the caller, and are only valid
+   * during this call. By default, values are copied to a new row.
+   */
+  virtual void SendView(const RowView &row) {
+    Send(Row(row.begin(), row.end()));
+  }
   virtual void Flush(){};
 };
 
+/**
+ * Discards all rows. Used for running queries only for the sake of their
+ * statistics.
+ */
+class NullRowOutput : public RowOutput {
+public:
+  void Send(const Row &row __attribute__((unused))) {}
+  void SendAsCol(const Row &col __attribute__((unused))) {}
+};
+
 class MemoryRowOutput : public RowOutput {
 public:
+  void AddHeader(const std::string &name, const std::string &value) {
+    headers_[name] = value;
+  }
   void Send(const Row &row) { rows_.push_back(row); }
   void SendAsCol(const Row &row) { rows_.push_back(row); }
 
+  const std::map<std::string, std::string> &headers() const {
+    return headers_;
+  }
   const std::vector<Row> &rows() const { return rows_; }
 
 private:
+  std::map<std::string, std::string> headers_;
   std::vector<Row> rows_;
 };
 
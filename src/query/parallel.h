@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_QUERY_PARALLEL_H_
+#define VIYA_QUERY_PARALLEL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace viya {
+namespace query {
+
+/**
+ * Runs parts of a query concurrently. Generated query code uses it for
+ * dispatching scan workers, without knowing which threads run them.
+ */
+class ParallelRunner {
+public:
+  virtual ~ParallelRunner() = default;
+
+  /**
+   * @return maximum number of tasks worth running concurrently
+   */
+  virtual size_t parallelism() const = 0;
+
+  /**
+   * Runs task(0) ... task(tasks - 1), and waits for all of them to complete.
+   * If any of the tasks throws, the exception is rethrown.
+   */
+  virtual void Run(size_t tasks, const std::function<void(size_t)> &task) = 0;
+};
+
+/**
+ * Sorts the given range using the runner: chunks of the range are sorted
+ * concurrently, and then they are merged pairwise.
+ */
+template <typename It, typename Compare>
+void ParallelSort(ParallelRunner &runner, It begin, It end, Compare cmp) {
+  size_t size = end - begin;
+  size_t chunks = std::min(runner.parallelism(), size);
+  if (chunks < 2) {
+    std::sort(begin, end, cmp);
+    return;
+  }
+
+  std::vector<size_t> bounds(chunks + 1);
+  for (size_t c = 0; c <= chunks; ++c) {
+    bounds[c] = size * c / chunks;
+  }
+  runner.Run(chunks, [&](size_t c) {
+    std::sort(begin + bounds[c], begin + bounds[c + 1], cmp);
+  });
+
+  for (size_t width = 1; width < chunks; width *= 2) {
+    runner.Run((chunks + width * 2 - 1) / (width * 2), [&](size_t m) {
+      size_t first = m * width * 2;
+      size_t middle = std::min(first + width, chunks);
+      size_t last = std::min(first + width * 2, chunks);
+      std::inplace_merge(begin + bounds[first], begin + bounds[middle],
+                         begin + bounds[last], cmp);
+    });
+  }
+}
+
+} // namespace query
+} // namespace viya
+
+#endif // VIYA_QUERY_PARALLEL_H_
@@ -19,12 +19,14 @@
 #include "db/table.h"
 #include "query/filter.h"
 #include "util/sanitize.h"
+#include <memory>
 
 namespace viya {
 namespace query {
 
 TableQuery::TableQuery(const util::Config &config, db::Table &table)
-    : table_(table), header_(config.boolean("header", false)) {}
+    : table_(table), header_(config.boolean("header", false)),
+      analyze_(config.boolean("analyze", false)) {}
 
 FilterBasedQuery::FilterBasedQuery(const util::Config &config, db::Table &table)
     : TableQuery(config, table) {
@@ -80,12 +82,37 @@ SelectQuery::SelectQuery(const util::Config &config, db::Table &table)
       metric_cols_.emplace_back(table.metric(metric_name), output_idx++);
     }
   }
+
+  if (config.exists("cursor")) {
+    cursor_ = Cursor::Parse(config.str("cursor"));
+    if (limit_ == 0) {
+      throw std::invalid_argument("Cursor can't be used without a limit");
+    }
+  }
 }
 
 void SelectQuery::Accept(QueryVisitor &visitor) { visitor.Visit(this); }
 
 AggregateQuery::AggregateQuery(const util::Config &config, db::Table &table)
-    : SelectQuery(config, table), having_(nullptr) {
+    : SelectQuery(config, table), having_(nullptr), parallelism_(0) {
+
+  long parallelism = config.num("parallelism", 0);
+  if (parallelism < 0) {
+    throw std::invalid_argument("Query parallelism can't be negative");
+  }
+  parallelism_ = parallelism;
+
+  if (cursor().enabled()) {
+    throw std::invalid_argument("Cursors are only supported by select queries");
+  }
+
+  if (config.exists("sample")) {
+    double fraction = config.real("sample", 1.0);
+    if (!(fraction > 0.0 && fraction <= 1.0)) {
+      throw std::invalid_argument("Sample fraction must be in (0, 1] range");
+    }
+    sample_ = Sample(fraction, config.num("sample_seed", 0));
+  }
 
   if (config.exists("sort")) {
     for (auto &sort_conf : config.sublist("sort")) {
@@ -147,12 +174,97 @@ ShowTablesQuery::ShowTablesQuery(db::Database &db) : DatabaseQuery(db) {}
 
 void ShowTablesQuery::Accept(QueryVisitor &visitor) { visitor.Visit(this); }
 
+/**
+ * Checks whether the time dimension of a view is truncated to a coarser
+ * granularity than the same dimension of the base table
+ */
+static bool Truncated(const db::Dimension *view_dim,
+                      const db::Dimension *base_dim) {
+  if (view_dim->dim_type() != db::Dimension::DimType::TIME) {
+    return false;
+  }
+  auto &granularity =
+      static_cast<const db::TimeDimension *>(view_dim)->granularity();
+  return !granularity.empty() &&
+         granularity.time_unit() !=
+             static_cast<const db::TimeDimension *>(base_dim)
+                 ->granularity()
+                 .time_unit();
+}
+
+static const db::Dimension *FindDimension(const db::Table &table,
+                                          const std::string &name) {
+  for (auto dim : table.dimensions()) {
+    if (dim->name() == name) {
+      return dim;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Checks whether a rollup view contains everything the query needs. Filters on
+ * truncated time dimensions are never covered, since their values may point
+ * into the middle of a time bucket. Filters on metrics aren't covered either,
+ * since they apply to stored records, which are aggregated differently in a
+ * view.
+ */
+static bool ViewCovers(const db::Table &view, AggregateQuery &query) {
+  ColumnsCollector filter_columns;
+  query.filter()->Accept(filter_columns);
+  for (auto &column : filter_columns.columns()) {
+    auto base_col = query.table().column(column);
+    if (base_col->type() != db::Column::Type::DIMENSION) {
+      return false;
+    }
+    auto dim = FindDimension(view, column);
+    if (dim == nullptr ||
+        Truncated(dim, static_cast<const db::Dimension *>(base_col))) {
+      return false;
+    }
+  }
+
+  for (auto &dim_col : query.dimension_cols()) {
+    auto dim = FindDimension(view, dim_col.dim()->name());
+    if (dim == nullptr) {
+      return false;
+    }
+    if (Truncated(dim, dim_col.dim())) {
+      // Requested time buckets must consist of the view buckets. Weeks are
+      // the only unit that doesn't divide into coarser units:
+      auto view_dim = static_cast<const db::TimeDimension *>(dim);
+      auto view_unit = view_dim->granularity().time_unit();
+      auto &granularity = dim_col.granularity();
+      if (granularity.empty() || granularity.time_unit() > view_unit ||
+          (granularity.time_unit() < view_unit &&
+           view_unit == util::TimeUnit::WEEK)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 Query *QueryFactory::Create(const util::Config &config,
                             db::Database &database) {
   auto type = config.str("type");
   if (type == "aggregate") {
     auto table = database.GetTable(config.str("table"));
-    return new AggregateQuery(config, *table);
+    std::unique_ptr<AggregateQuery> query(new AggregateQuery(config, *table));
+
+    // Run the query on the smallest rollup view that covers it:
+    db::Table *best_view = nullptr;
+    for (auto view : table->views()) {
+      if (ViewCovers(*view, *query) &&
+          (best_view == nullptr ||
+           view->dimensions().size() < best_view->dimensions().size())) {
+        best_view = view;
+      }
+    }
+    if (best_view != nullptr) {
+      return new AggregateQuery(config, *best_view);
+    }
+    return query.release();
   }
   if (type == "search") {
     auto table = database.GetTable(config.str("table"));
@@ -19,7 +19,9 @@
 
 #include "db/column.h"
 #include "db/rollup.h"
+#include "query/cursor.h"
 #include "query/filter.h"
+#include "query/sample.h"
 
 namespace viya {
 namespace db {
@@ -72,11 +74,19 @@ public:
   virtual void Accept(class QueryVisitor &visitor) = 0;
 
   db::Table &table() { return table_; }
+  const db::Table &table() const { return table_; }
   bool header() const { return header_; }
 
+  /**
+   * @return whether the query is only run for reporting its plan and
+   *         execution stages timings instead of the result
+   */
+  bool analyze() const { return analyze_; }
+
 private:
   db::Table &table_;
   bool header_;
+  bool analyze_;
 };
 
 class FilterBasedQuery : public TableQuery {
@@ -178,6 +188,12 @@ public:
 
   size_t limit() const { return limit_; }
 
+  /**
+   * @return position to start scanning from, when results are paginated
+   *         using cursors
+   */
+  const Cursor &cursor() const { return cursor_; }
+
   void Accept(class QueryVisitor &visitor) override;
 
 private:
@@ -185,6 +201,7 @@ private:
   std::vector<MetricOutputColumn> metric_cols_;
   size_t skip_;
   size_t limit_;
+  Cursor cursor_;
 };
 
 class AggregateQuery : public SelectQuery {
@@ -197,11 +214,24 @@ public:
 
   const std::vector<SortColumn> &sort_cols() const { return sort_cols_; }
 
+  /**
+   * @return number of threads for scanning, or 0 for using the default value
+   */
+  size_t parallelism() const { return parallelism_; }
+
+  /**
+   * @return sample of segments to scan, which is disabled unless the query
+   *         asks for an approximate result
+   */
+  const Sample &sample() const { return sample_; }
+
   void Accept(class QueryVisitor &visitor) override;
 
 private:
   std::vector<SortColumn> sort_cols_;
   Filter *having_;
+  size_t parallelism_;
+  Sample sample_;
 };
 
 class SearchQuery : public FilterBasedQuery {
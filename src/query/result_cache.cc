@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "query/result_cache.h"
+#include "db/database.h"
+#include "db/table.h"
+#include "util/statsd.h"
+
+namespace viya {
+namespace query {
+
+/**
+ * Passes rows to the actual output, while keeping their copy for the cache
+ * unless the result gets too large
+ */
+class RecordingRowOutput : public RowOutput {
+public:
+  RecordingRowOutput(RowOutput &output, size_t max_size)
+      : output_(output), max_size_(max_size), size_(0), overflow_(false) {}
+
+  void AddHeader(const std::string &name, const std::string &value) {
+    output_.AddHeader(name, value);
+    headers_.emplace_back(name, value);
+  }
+
+  void Start() { output_.Start(); }
+
+  void Send(const Row &row) {
+    output_.Send(row);
+    Record(row, false);
+  }
+
+  void SendView(const RowView &row) {
+    output_.SendView(row);
+    if (!overflow_) {
+      Record(Row(row.begin(), row.end()), false);
+    }
+  }
+
+  void SendAsCol(const Row &col) {
+    output_.SendAsCol(col);
+    Record(col, true);
+  }
+
+  void Flush() { output_.Flush(); }
+
+  bool overflow() const { return overflow_; }
+  size_t size() const { return size_; }
+  std::vector<std::pair<std::string, std::string>> &headers() {
+    return headers_;
+  }
+  std::vector<std::pair<bool, Row>> &rows() { return rows_; }
+
+private:
+  void Record(const Row &row, bool as_col) {
+    if (overflow_) {
+      return;
+    }
+    size_ += sizeof(row);
+    for (auto &value : row) {
+      size_ += sizeof(value) + value.size();
+    }
+    if (size_ > max_size_) {
+      overflow_ = true;
+      rows_.clear();
+      return;
+    }
+    rows_.emplace_back(as_col, row);
+  }
+
+private:
+  RowOutput &output_;
+  const size_t max_size_;
+  size_t size_;
+  bool overflow_;
+  std::vector<std::pair<std::string, std::string>> headers_;
+  std::vector<std::pair<bool, Row>> rows_;
+};
+
+ResultCache::ResultCache(const util::Config &config, db::Database &database)
+    : database_(database), max_size_(config.num("result_cache_size", 0)),
+      size_(0) {}
+
+QueryStats ResultCache::Run(const util::Config &query_conf, RowOutput &output,
+                            const QueryFn &run) {
+  // Analysis reports timings of the actual run, so it's never cached:
+  if (max_size_ == 0 || !query_conf.exists("table") ||
+      query_conf.boolean("analyze", false)) {
+    return run(output);
+  }
+
+  // Read the version before checking for writes in progress, so a write
+  // that starts in between makes the result uncacheable:
+  auto table = database_.GetTable(query_conf.str("table"));
+  auto version = table->data_version();
+  bool cacheable = !table->writing();
+  std::string key = std::to_string(version) + ":" + query_conf.dump();
+
+  auto &statsd = database_.statsd();
+  if (cacheable) {
+    auto result = Get(key);
+    if (result) {
+      statsd.Increment("query.cache.hits");
+      QueryStats stats(result->stats);
+      stats.OnBegin(stats.query_type_, stats.table_);
+      for (auto &header : result->headers) {
+        output.AddHeader(header.first, header.second);
+      }
+      output.Start();
+      for (auto &row : result->rows) {
+        if (row.first) {
+          output.SendAsCol(row.second);
+        } else {
+          output.Send(row.second);
+        }
+      }
+      output.Flush();
+      stats.compile_time = cr::duration<float>::zero();
+      stats.OnEnd();
+      return stats;
+    }
+  }
+  statsd.Increment("query.cache.misses");
+
+  // A single result can't occupy too much of the cache:
+  RecordingRowOutput recording(output, max_size_ / 8);
+  auto stats = run(recording);
+
+  if (cacheable && !recording.overflow() && table->data_version() == version) {
+    Put(key, std::make_shared<const Result>(
+                 Result{std::move(recording.headers()),
+                        std::move(recording.rows()), stats,
+                        recording.size() + key.size()}));
+  }
+  return stats;
+}
+
+std::shared_ptr<const ResultCache::Result>
+ResultCache::Get(const std::string &key) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  lru_.splice(lru_.end(), lru_, it->second.lru_pos);
+  return it->second.result;
+}
+
+void ResultCache::Put(const std::string &key,
+                      std::shared_ptr<const Result> result) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (entries_.find(key) != entries_.end()) {
+    return;
+  }
+  size_ += result->size;
+  entries_.emplace(key, Entry{result, lru_.insert(lru_.end(), key)});
+
+  while (size_ > max_size_) {
+    auto it = entries_.find(lru_.front());
+    size_ -= it->second.result->size;
+    entries_.erase(it);
+    lru_.pop_front();
+  }
+}
+
+size_t ResultCache::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return size_;
+}
+
+void ResultCache::Clear() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  entries_.clear();
+  lru_.clear();
+  size_ = 0;
+}
+
+} // namespace query
+} // namespace viya
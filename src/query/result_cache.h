@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_QUERY_RESULT_CACHE_H_
+#define VIYA_QUERY_RESULT_CACHE_H_
+
+#include "query/output.h"
+#include "query/stats.h"
+#include "util/config.h"
+#include "util/macros.h"
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace viya {
+namespace db {
+
+class Database;
+
+} // namespace db
+} // namespace viya
+
+namespace viya {
+namespace query {
+
+namespace db = viya::db;
+namespace util = viya::util;
+
+/**
+ * Keeps results of recent table queries. Result is keyed by the query and the
+ * data version of its table, so it's reused until the table is modified.
+ * Total size of cached results is bounded by `result_cache_size` bytes (0
+ * disables the cache), and the least recently used results are evicted.
+ */
+class ResultCache {
+public:
+  using QueryFn = std::function<QueryStats(RowOutput &)>;
+
+  ResultCache(const util::Config &config, db::Database &database);
+  DISALLOW_COPY_AND_MOVE(ResultCache);
+
+  /**
+   * Sends cached result of the query to the output, or runs the query if
+   * there's no such result.
+   */
+  QueryStats Run(const util::Config &query_conf, RowOutput &output,
+                 const QueryFn &run);
+
+  /**
+   * Removes all cached results (table versions are not unique across
+   * re-creations of a table)
+   */
+  void Clear();
+
+  size_t size() const;
+
+private:
+  struct Result {
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::vector<std::pair<bool, RowOutput::Row>> rows;
+    QueryStats stats;
+    size_t size;
+  };
+
+  struct Entry {
+    std::shared_ptr<const Result> result;
+    std::list<std::string>::iterator lru_pos;
+  };
+
+  std::shared_ptr<const Result> Get(const std::string &key);
+  void Put(const std::string &key, std::shared_ptr<const Result> result);
+
+private:
+  db::Database &database_;
+  const size_t max_size_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::list<std::string> lru_;
+  size_t size_;
+};
+
+} // namespace query
+} // namespace viya
+
+#endif // VIYA_QUERY_RESULT_CACHE_H_
@@ -19,36 +19,180 @@
 #include "codegen/query/filter.h"
 #include "codegen/query/search_query.h"
 #include "codegen/query/select_query.h"
+#include "db/store.h"
 #include "db/table.h"
+#include "query/interpreter.h"
+#include <exception>
+#include <future>
+#include <sstream>
+#include <string>
+#include <vector>
 
 namespace viya {
 namespace query {
 
 namespace cg = viya::codegen;
 
+void PoolParallelRunner::Run(size_t tasks,
+                             const std::function<void(size_t)> &task) {
+  std::vector<std::future<void>> futures;
+  futures.reserve(tasks);
+  for (size_t i = 1; i < tasks; ++i) {
+    futures.push_back(pool_.enqueue(task, i));
+  }
+
+  std::exception_ptr error;
+  try {
+    task(0);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  for (auto &f : futures) {
+    try {
+      f.get();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+RowOutput &QueryRunner::QueryOutput(TableQuery *query) {
+  if (query->analyze()) {
+    return null_output_;
+  }
+  return output_;
+}
+
+void QueryRunner::OnCompile(TableQuery *query) {
+  stats_.OnCompile();
+  if (query->analyze()) {
+    stats_.StageEnd("compile");
+  }
+}
+
+void QueryRunner::OnEnd(TableQuery *query, bool compiled,
+                        uint64_t code_hash) {
+  if (query->analyze() && !compiled) {
+    // The interpreter doesn't break its work into stages:
+    stats_.StageEnd("interpret");
+  }
+  stats_.OnEnd();
+  cancellation_.Check(stats_);
+
+  if (!query->analyze()) {
+    return;
+  }
+
+  // Report the plan and execution statistics instead of the query rows:
+  std::vector<RowOutput::Row> report;
+  report.push_back({"query_type", stats_.query_type_});
+  report.push_back({"table", stats_.table_});
+  report.push_back({"execution", compiled ? "compiled" : "interpreted"});
+
+  std::ostringstream hash;
+  hash << std::hex << code_hash;
+  report.push_back({"code_hash", hash.str()});
+
+  for (auto &plan : stats_.plan) {
+    report.push_back({plan.first, plan.second});
+  }
+
+  report.push_back(
+      {"scanned_segments", std::to_string(stats_.scanned_segments)});
+  report.push_back({"scanned_recs", std::to_string(stats_.scanned_recs)});
+  report.push_back(
+      {"aggregated_recs", std::to_string(stats_.aggregated_recs)});
+  report.push_back({"output_recs", std::to_string(stats_.output_recs)});
+
+  auto ms = [](cr::duration<float> d) {
+    return std::to_string(cr::duration<float, std::milli>(d).count());
+  };
+  for (auto &stage : stats_.stages) {
+    report.push_back({"stage." + stage.name + ".wall_ms", ms(stage.wall_time)});
+    report.push_back({"stage." + stage.name + ".cpu_ms", ms(stage.cpu_time)});
+  }
+  report.push_back({"wall_ms", ms(stats_.whole_time)});
+
+  output_.Start();
+  if (query->header()) {
+    output_.Send({"name", "value"});
+  }
+  for (auto &row : report) {
+    output_.Send(row);
+  }
+  output_.Flush();
+}
+
+void QueryRunner::SendPage(const MemoryRowOutput &page,
+                           const Cursor &cursor) {
+  // There's no next page if the scan has reached the end of the table:
+  if (cursor.more()) {
+    output_.AddHeader("X-Next-Cursor", cursor.ToString());
+  }
+  for (auto &header : page.headers()) {
+    output_.AddHeader(header.first, header.second);
+  }
+  output_.Start();
+  for (auto &row : page.rows()) {
+    output_.Send(row);
+  }
+  output_.Flush();
+}
+
 void QueryRunner::Visit(SelectQuery *query) {
   stats_.OnBegin("select", query->table().name());
 
-  auto query_fn =
-      cg::SelectQueryGenerator(database_.compiler(), *query).Function();
+  // The cursor can only be returned in a header, which must precede the rows,
+  // so the page is kept in memory until the scan ends:
+  auto cursor = query->cursor();
+  MemoryRowOutput page;
+  bool paginated = cursor.enabled() && !query->analyze();
+  if (cursor.enabled()) {
+    cursor.Bind(query->table().store()->layout_version());
+  }
+
+  // If the query can be interpreted, don't wait for its code to compile:
+  cg::SelectQueryGenerator generator(database_.compiler(), *query);
+  bool interpret =
+      database_.interpret_queries() && Interpreter::Supports(query);
+  auto query_fn = interpret ? generator.TryFunction() : generator.Function();
 
-  stats_.OnCompile();
+  OnCompile(query);
 
   cg::FilterArgsPacker filter_args(query->table());
   query->filter()->Accept(filter_args);
 
-  query_fn(query->table(), output_, stats_, filter_args.args(), query->skip(),
-           query->limit());
-  stats_.OnEnd();
+  if (query_fn == nullptr) {
+    Interpreter interpreter(QueryOutput(query), stats_, cancellation_,
+                            filter_args.args());
+    interpreter.Visit(query);
+  } else {
+    query_fn(query->table(),
+             paginated ? static_cast<RowOutput &>(page) : QueryOutput(query),
+             stats_, filter_args.args(), query->skip(), query->limit(), cursor,
+             cancellation_);
+  }
+  OnEnd(query, query_fn != nullptr, generator.code_hash());
+
+  if (paginated) {
+    SendPage(page, cursor);
+  }
 }
 
 void QueryRunner::Visit(AggregateQuery *query) {
   stats_.OnBegin("aggregate", query->table().name());
 
-  auto query_fn =
-      cg::AggQueryGenerator(database_.compiler(), *query).Function();
+  cg::AggQueryGenerator generator(database_.compiler(), *query);
+  bool interpret =
+      database_.interpret_queries() && Interpreter::Supports(query);
+  auto query_fn = interpret ? generator.TryFunction() : generator.Function();
 
-  stats_.OnCompile();
+  OnCompile(query);
 
   cg::FilterArgsPacker filter_args(query->table());
   query->filter()->Accept(filter_args);
@@ -58,25 +202,45 @@ void QueryRunner::Visit(AggregateQuery *query) {
     query->having()->Accept(having_args);
   }
 
-  query_fn(query->table(), output_, stats_, filter_args.args(), query->skip(),
-           query->limit(), having_args.args());
-  stats_.OnEnd();
+  PoolParallelRunner parallel(database_.scan_pool(),
+                              query->parallelism() > 0
+                                  ? query->parallelism()
+                                  : database_.query_parallelism());
+
+  if (query_fn == nullptr) {
+    Interpreter interpreter(QueryOutput(query), stats_, cancellation_,
+                            filter_args.args(), having_args.args());
+    interpreter.Visit(query);
+  } else {
+    query_fn(query->table(), QueryOutput(query), stats_, filter_args.args(),
+             query->skip(), query->limit(), having_args.args(), parallel,
+             query->sample(), cancellation_);
+  }
+  OnEnd(query, query_fn != nullptr, generator.code_hash());
 }
 
 void QueryRunner::Visit(SearchQuery *query) {
   stats_.OnBegin("search", query->table().name());
 
-  auto query_fn =
-      cg::SearchQueryGenerator(database_.compiler(), *query).Function();
+  cg::SearchQueryGenerator generator(database_.compiler(), *query);
+  bool interpret =
+      database_.interpret_queries() && Interpreter::Supports(query);
+  auto query_fn = interpret ? generator.TryFunction() : generator.Function();
 
-  stats_.OnCompile();
+  OnCompile(query);
 
   cg::FilterArgsPacker filter_args(query->table());
   query->filter()->Accept(filter_args);
 
-  query_fn(query->table(), output_, stats_, filter_args.args(), query->term(),
-           query->limit());
-  stats_.OnEnd();
+  if (query_fn == nullptr) {
+    Interpreter interpreter(QueryOutput(query), stats_, cancellation_,
+                            filter_args.args());
+    interpreter.Visit(query);
+  } else {
+    query_fn(query->table(), QueryOutput(query), stats_, filter_args.args(),
+             query->term(), query->limit(), cancellation_);
+  }
+  OnEnd(query, query_fn != nullptr, generator.code_hash());
 }
 
 void QueryRunner::Visit(ShowTablesQuery *query) {
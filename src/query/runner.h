@@ -18,7 +18,10 @@
 #define VIYA_DB_RUNNER_H_
 
 #include "db/database.h"
+#include "query/cancel.h"
+#include "query/cursor.h"
 #include "query/output.h"
+#include "query/parallel.h"
 #include "query/query.h"
 #include "query/stats.h"
 
@@ -28,20 +31,41 @@ namespace query {
 namespace db = viya::db;
 
 using SelectQueryFn = void (*)(db::Table &, RowOutput &, QueryStats &,
-                               std::vector<db::AnyNum>, size_t, size_t);
+                               std::vector<db::AnyNum>, size_t, size_t,
+                               Cursor &, const Cancellation &);
 
 using AggQueryFn = void (*)(db::Table &, RowOutput &, QueryStats &,
                             std::vector<db::AnyNum>, size_t, size_t,
-                            std::vector<db::AnyNum>);
+                            std::vector<db::AnyNum>, ParallelRunner &,
+                            const Sample &, const Cancellation &);
 
 using SearchQueryFn = void (*)(db::Table &, RowOutput &, QueryStats &,
                                std::vector<db::AnyNum>, const std::string &,
-                               size_t);
+                               size_t, const Cancellation &);
+
+/**
+ * Runs scan tasks of a single query on the database scan pool. The first
+ * task is executed by the calling thread.
+ */
+class PoolParallelRunner : public ParallelRunner {
+public:
+  PoolParallelRunner(ThreadPool &pool, size_t parallelism)
+      : pool_(pool), parallelism_(parallelism) {}
+
+  size_t parallelism() const override { return parallelism_; }
+  void Run(size_t tasks, const std::function<void(size_t)> &task) override;
+
+private:
+  ThreadPool &pool_;
+  size_t parallelism_;
+};
 
 class QueryRunner : public QueryVisitor {
 public:
-  QueryRunner(db::Database &database, RowOutput &output)
-      : database_(database), output_(output), stats_(database.statsd()) {}
+  QueryRunner(db::Database &database, RowOutput &output,
+              const Cancellation &cancellation)
+      : database_(database), output_(output), cancellation_(cancellation),
+        stats_(database.statsd()) {}
 
   void Visit(SelectQuery *query) override;
   void Visit(AggregateQuery *query) override;
@@ -53,10 +77,26 @@ public:
 private:
   void RunFilterBasedQuery(FilterBasedQuery *query);
 
+  /**
+   * @return output for the query rows, which discards them in analyze mode
+   */
+  RowOutput &QueryOutput(TableQuery *query);
+
+  void OnCompile(TableQuery *query);
+  void OnEnd(TableQuery *query, bool compiled, uint64_t code_hash);
+
+  /**
+   * Sends a page of paginated query results along with the cursor pointing
+   * to the next page
+   */
+  void SendPage(const MemoryRowOutput &page, const Cursor &cursor);
+
 private:
   db::Database &database_;
   RowOutput &output_;
+  const Cancellation &cancellation_;
   QueryStats stats_;
+  NullRowOutput null_output_;
 };
 
 } // namespace query
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_QUERY_SAMPLE_H_
+#define VIYA_QUERY_SAMPLE_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace viya {
+namespace query {
+
+/**
+ * Sample of table segments scanned by an approximate aggregate query. Every
+ * segment is chosen independently with the given probability, based on a hash
+ * of its position and the seed. Therefore, the same query sees the same
+ * sample as long as the table segments don't change.
+ *
+ * This is used by the generated code, so it's header only.
+ */
+class Sample {
+public:
+  Sample() : fraction_(1.0), seed_(0) {}
+  Sample(double fraction, uint64_t seed) : fraction_(fraction), seed_(seed) {}
+
+  bool enabled() const { return fraction_ < 1.0; }
+  double fraction() const { return fraction_; }
+  uint64_t seed() const { return seed_; }
+
+  /**
+   * Leaves only the sampled segments in the list. At least one non-empty
+   * segment is sampled, if there's any.
+   *
+   * @return scale factor for totals computed from the sample, which is the
+   *         ratio of records in all segments to records in sampled segments
+   */
+  template <typename Segment>
+  double Select(std::vector<Segment *> &segments) const {
+    size_t total_recs = 0;
+    size_t sampled_recs = 0;
+    std::vector<Segment *> sampled;
+    size_t fallback = segments.size();
+    uint64_t fallback_hash = std::numeric_limits<uint64_t>::max();
+
+    for (size_t idx = 0; idx < segments.size(); ++idx) {
+      auto size = segments[idx]->size();
+      if (size == 0) {
+        continue;
+      }
+      total_recs += size;
+      auto hash = Hash(idx);
+      if ((hash >> 11) * 0x1.0p-53 < fraction_) {
+        sampled.push_back(segments[idx]);
+        sampled_recs += size;
+      } else if (hash < fallback_hash) {
+        fallback = idx;
+        fallback_hash = hash;
+      }
+    }
+    if (sampled.empty() && fallback < segments.size()) {
+      sampled.push_back(segments[fallback]);
+      sampled_recs = segments[fallback]->size();
+    }
+
+    segments.swap(sampled);
+    return sampled_recs > 0 ? (double)total_recs / sampled_recs : 1.0;
+  }
+
+  /**
+   * Estimates the relative error of a total at 95% confidence level, given
+   * the totals of sampled segments. The variance estimate is the one of
+   * Bernoulli sampling with probability of 1 / scale.
+   */
+  static double RelativeError(const std::vector<double> &segment_totals,
+                              double scale) {
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    for (auto total : segment_totals) {
+      sum += total;
+      sum_squares += total * total;
+    }
+    if (sum == 0.0) {
+      return 0.0;
+    }
+    double variance = (scale * scale - scale) * sum_squares;
+    return 1.96 * std::sqrt(variance) / std::abs(scale * sum);
+  }
+
+private:
+  uint64_t Hash(size_t idx) const {
+    // SplitMix64 finalizer:
+    uint64_t h = seed_ + (idx + 1) * 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+  }
+
+private:
+  double fraction_;
+  uint64_t seed_;
+};
+
+} // namespace query
+} // namespace viya
+
+#endif // VIYA_QUERY_SAMPLE_H_
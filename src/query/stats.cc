@@ -27,6 +27,7 @@ void QueryStats::OnBegin(const std::string &query_type,
   query_type_ = query_type;
   table_ = table;
   begin_work_ = cr::steady_clock::now();
+  StageBegin();
 }
 
 void QueryStats::OnCompile() {
@@ -18,7 +18,10 @@
 #define VIYA_QUERY_STATS_H_
 
 #include <chrono>
+#include <ctime>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace viya {
 namespace util {
@@ -34,6 +37,15 @@ namespace util = viya::util;
 
 class QueryStats {
 public:
+  /**
+   * Wall and CPU time spent in a single stage of query execution
+   */
+  struct Stage {
+    std::string name;
+    cr::duration<float> wall_time;
+    cr::duration<float> cpu_time;
+  };
+
   QueryStats(const util::Statsd &statsd)
       : statsd_(statsd), scanned_segments(0), scanned_recs(0),
         aggregated_recs(0), output_recs(0) {}
@@ -42,6 +54,46 @@ public:
   void OnCompile();
   void OnEnd();
 
+  /**
+   * Records a detail of the query plan. Plan details and stages are only
+   * collected by queries running in analyze mode.
+   */
+  void AddPlan(const std::string &name, const std::string &value) {
+    plan.emplace_back(name, value);
+  }
+
+  /**
+   * Starts measuring a new stage
+   */
+  void StageBegin() {
+    stage_begin_ = cr::steady_clock::now();
+    stage_cpu_begin_ = ThreadCpuTime();
+  }
+
+  /**
+   * Ends the current stage, and starts measuring the next one
+   *
+   * @param name stage name
+   * @param other_cpu_time CPU time spent on other threads during this stage
+   */
+  void StageEnd(const std::string &name,
+                cr::duration<float> other_cpu_time = cr::duration<float>(0)) {
+    auto cpu_time = ThreadCpuTime();
+    stages.push_back({name, cr::steady_clock::now() - stage_begin_,
+                      cpu_time - stage_cpu_begin_ + other_cpu_time});
+    stage_begin_ = cr::steady_clock::now();
+    stage_cpu_begin_ = cpu_time;
+  }
+
+  /**
+   * @return CPU time consumed by the calling thread so far
+   */
+  static cr::duration<float> ThreadCpuTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return cr::seconds(ts.tv_sec) + cr::nanoseconds(ts.tv_nsec);
+  }
+
 public:
   const util::Statsd &statsd_;
   std::string query_type_;
@@ -52,9 +104,13 @@ public:
   size_t output_recs;
   cr::duration<float> compile_time;
   cr::duration<float> whole_time;
+  std::vector<std::pair<std::string, std::string>> plan;
+  std::vector<Stage> stages;
 
 private:
   cr::steady_clock::time_point begin_work_;
+  cr::steady_clock::time_point stage_begin_;
+  cr::duration<float> stage_cpu_begin_;
 };
 
 } // namespace query
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "query/warmup.h"
+#include "codegen/query/agg_query.h"
+#include "codegen/query/search_query.h"
+#include "codegen/query/select_query.h"
+#include "db/database.h"
+#include "query/query.h"
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <glog/logging.h>
+#include <nlohmann/json.hpp>
+
+namespace viya {
+namespace query {
+
+namespace cg = viya::codegen;
+namespace fs = boost::filesystem;
+
+using json = nlohmann::json;
+
+/**
+ * Loads compiled code of a query without running it
+ */
+class QueryWarmer : public QueryVisitor {
+public:
+  QueryWarmer(cg::Compiler &compiler) : compiler_(compiler) {}
+
+  void Visit(SelectQuery *query) {
+    cg::SelectQueryGenerator(compiler_, *query).Function();
+  }
+
+  void Visit(AggregateQuery *query) {
+    cg::AggQueryGenerator(compiler_, *query).Function();
+  }
+
+  void Visit(SearchQuery *query) {
+    cg::SearchQueryGenerator(compiler_, *query).Function();
+  }
+
+private:
+  cg::Compiler &compiler_;
+};
+
+static void StripValues(json &filter) {
+  if (filter.count("value")) {
+    filter["value"] = "";
+  }
+  if (filter.count("values")) {
+    for (auto &value : filter["values"]) {
+      value = "";
+    }
+  }
+  if (filter.count("filters")) {
+    for (auto &f : filter["filters"]) {
+      StripValues(f);
+    }
+  }
+  if (filter.count("filter")) {
+    StripValues(filter["filter"]);
+  }
+}
+
+/**
+ * Replaces query fields that are used at run-time only with fixed values
+ */
+static void StripRunTimeFields(json &query) {
+  for (auto field : {"skip", "timeout", "parallelism", "sample_seed"}) {
+    query.erase(field);
+  }
+  // Generated code only depends on whether there's a limit, a cursor and a
+  // sample:
+  if (query.count("limit")) {
+    if (query["limit"].get<long>() > 0) {
+      query["limit"] = 1;
+    } else {
+      query.erase("limit");
+    }
+  }
+  if (query.count("cursor")) {
+    query["cursor"] = "";
+  }
+  if (query.count("sample")) {
+    if (query["sample"].get<double>() < 1.0) {
+      query["sample"] = 0.5;
+    } else {
+      query.erase("sample");
+    }
+  }
+}
+
+Warmup::Warmup(const util::Config &config, db::Database &database)
+    : database_(database), max_queries_(config.num("warmup_queries", 0)),
+      file_(config.str("state_dir", "/tmp/viyadb") + "/query_shapes.json"),
+      unsaved_(0), save_pending_(false), stopped_(false) {
+  if (max_queries_ > 0) {
+    pool_ = std::make_unique<ThreadPool>(1);
+    Load();
+  }
+}
+
+Warmup::~Warmup() { Stop(); }
+
+void Warmup::Record(const util::Config &query_conf) {
+  if (max_queries_ == 0 || !query_conf.exists("table")) {
+    return;
+  }
+  json shape = *query_conf.json_ptr();
+  if (shape.count("filter")) {
+    StripValues(shape["filter"]);
+  }
+  if (shape.count("having")) {
+    StripValues(shape["having"]);
+  }
+  if (shape.count("term")) {
+    shape["term"] = "";
+  }
+  StripRunTimeFields(shape);
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto key = shape.dump();
+  auto it = shapes_.find(key);
+  if (it != shapes_.end()) {
+    ++it->second.frequency;
+    if (++unsaved_ >= SAVE_EVERY) {
+      ScheduleSave();
+    }
+    return;
+  }
+
+  // Keep the number of stored shapes bounded by evicting the least frequent
+  // half at once, so that eviction cost is amortized across new shapes:
+  if (shapes_.size() >= max_queries_ * 10) {
+    std::vector<decltype(shapes_)::iterator> evicted;
+    for (auto shape_it = shapes_.begin(); shape_it != shapes_.end();
+         ++shape_it) {
+      evicted.push_back(shape_it);
+    }
+    auto middle = evicted.begin() + evicted.size() / 2;
+    std::nth_element(evicted.begin(), middle, evicted.end(),
+                     [](auto &a, auto &b) {
+                       return a->second.frequency < b->second.frequency;
+                     });
+    evicted.erase(middle, evicted.end());
+    for (auto shape_it : evicted) {
+      shapes_.erase(shape_it);
+    }
+  }
+  shapes_.emplace(key, Shape{shape["table"].get<std::string>(), 1});
+  ScheduleSave();
+}
+
+std::vector<std::pair<util::Config, size_t>>
+Warmup::Shapes(const std::string &table) {
+  std::vector<std::pair<util::Config, size_t>> shapes;
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto &it : shapes_) {
+    if (it.second.table == table) {
+      shapes.emplace_back(util::Config(it.first), it.second.frequency);
+    }
+  }
+  std::stable_sort(
+      shapes.begin(), shapes.end(),
+      [](auto &a, auto &b) { return a.second > b.second; });
+  return shapes;
+}
+
+void Warmup::Replay(const std::string &table) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (!pool_ || stopped_) {
+    return;
+  }
+  pool_->enqueue([this, table]() {
+    auto shapes = Shapes(table);
+    if (shapes.size() > max_queries_) {
+      shapes.resize(max_queries_);
+    }
+    if (!shapes.empty()) {
+      LOG(INFO) << "Warming up " << shapes.size() << " queries of: " << table;
+    }
+    QueryWarmer warmer(database_.compiler());
+    QueryFactory query_factory;
+    for (auto &shape : shapes) {
+      if (stopped_) {
+        return;
+      }
+      try {
+        std::unique_ptr<Query> query(
+            query_factory.Create(shape.first, database_));
+        query->Accept(warmer);
+      } catch (std::exception &e) {
+        // Shape may refer to columns that don't exist anymore:
+        LOG(WARNING) << "Can't warm up query: " << e.what();
+      }
+    }
+  });
+}
+
+void Warmup::Stop() {
+  if (max_queries_ == 0 || stopped_.exchange(true)) {
+    return;
+  }
+  // Waits for the running replay and save to complete:
+  std::unique_ptr<ThreadPool> pool;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    pool = std::move(pool_);
+  }
+  pool.reset();
+  Save();
+}
+
+void Warmup::Load() {
+  if (!fs::exists(file_)) {
+    return;
+  }
+  try {
+    std::ifstream in(file_);
+    json shapes = json::parse(in);
+    for (auto &shape : shapes) {
+      auto &query = shape["query"];
+      shapes_.emplace(query.dump(), Shape{query["table"].get<std::string>(),
+                                          shape["frequency"].get<size_t>()});
+    }
+  } catch (std::exception &e) {
+    LOG(WARNING) << "Can't read query shapes from " << file_ << ": "
+                 << e.what();
+  }
+}
+
+void Warmup::ScheduleSave() {
+  if (!pool_ || save_pending_) {
+    return;
+  }
+  save_pending_ = true;
+  pool_->enqueue([this]() { Save(); });
+}
+
+void Warmup::Save() {
+  json shapes = json::array();
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto &it : shapes_) {
+      shapes.push_back({{"query", json::parse(it.first)},
+                        {"frequency", it.second.frequency}});
+    }
+    unsaved_ = 0;
+    save_pending_ = false;
+  }
+
+  try {
+    std::string tmp_file = file_ + ".tmp";
+    std::ofstream out(tmp_file);
+    out << shapes.dump();
+    out.close();
+    fs::rename(fs::path(tmp_file), fs::path(file_));
+  } catch (std::exception &e) {
+    LOG(WARNING) << "Can't write query shapes to " << file_ << ": "
+                 << e.what();
+  }
+}
+
+} // namespace query
+} // namespace viya
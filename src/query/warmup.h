@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_QUERY_WARMUP_H_
+#define VIYA_QUERY_WARMUP_H_
+
+#include "util/config.h"
+#include "util/macros.h"
+#include <ThreadPool/ThreadPool.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace viya {
+namespace db {
+
+class Database;
+
+} // namespace db
+} // namespace viya
+
+namespace viya {
+namespace query {
+
+namespace db = viya::db;
+namespace util = viya::util;
+
+/**
+ * Keeps track of query shapes, and replays the most frequent ones in
+ * background when their table is created, so that the compiled code is
+ * loaded before the first queries arrive. Query shape is the query with all
+ * the filter values and run-time options stripped, since they don't affect
+ * the generated code.
+ *
+ * Shapes are persisted in background to the state directory together with
+ * their execution frequencies. Up to `warmup_queries` shapes are replayed per
+ * table (0 disables the warmup).
+ */
+class Warmup {
+public:
+  Warmup(const util::Config &config, db::Database &database);
+  DISALLOW_COPY_AND_MOVE(Warmup);
+  ~Warmup();
+
+  /**
+   * Records an execution of the query
+   */
+  void Record(const util::Config &query_conf);
+
+  /**
+   * Loads code of the most frequent queries of the table in background
+   */
+  void Replay(const std::string &table);
+
+  /**
+   * Cancels pending replays, and persists the recorded shapes
+   */
+  void Stop();
+
+  /**
+   * @return recorded shapes of the table with their frequencies, most
+   *         frequent first
+   */
+  std::vector<std::pair<util::Config, size_t>>
+  Shapes(const std::string &table);
+
+private:
+  struct Shape {
+    std::string table;
+    size_t frequency;
+  };
+
+  void Load();
+  void ScheduleSave();
+  void Save();
+
+private:
+  static const size_t SAVE_EVERY = 100;
+
+  db::Database &database_;
+  size_t max_queries_;
+  std::string file_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, Shape> shapes_;
+  size_t unsaved_;
+  bool save_pending_;
+  std::atomic<bool> stopped_;
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace query
+} // namespace viya
+
+#endif // VIYA_QUERY_WARMUP_H_
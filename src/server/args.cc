@@ -78,6 +78,11 @@ util::Config CmdlineArgs::Defaults() {
   util::Config config;
   config.set_num("http_port", 5000);
   config.set_num("query_threads", 1);
+  config.set_num("write_threads", 2);
+  config.set_num("query_max_queued", 1000);
+  config.set_boolean("interpret_queries", true);
+  config.set_num("warmup_queries", 100);
+  config.set_num("result_cache_size", 64 * 1024 * 1024);
   config.set_boolean("supervise", false);
   config.set_str("state_dir", "/var/lib/viyadb");
 
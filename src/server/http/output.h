@@ -19,6 +19,7 @@
 
 #include "query/output.h"
 #include "util/macros.h"
+#include <functional>
 #include <ostream>
 #include <unordered_map>
 
@@ -33,7 +34,7 @@ public:
   ChunkedTsvOutput(std::ostream &stream, char col_sep = '\t',
                    char row_sep = '\n')
       : stream_(stream), chunk_size_(16384), col_sep_(col_sep),
-        row_sep_(row_sep) {}
+        row_sep_(row_sep), started_(false) {}
 
   DISALLOW_COPY_AND_MOVE(ChunkedTsvOutput);
   ~ChunkedTsvOutput() {}
@@ -42,7 +43,19 @@ public:
     headers_.emplace(name, value);
   }
 
+  /**
+   * Sets a function to call every time a chunk is written to the stream. The
+   * next chunk is only written once the function returns.
+   */
+  void OnChunk(std::function<void()> callback) { on_chunk_ = callback; }
+
+  /**
+   * @return whether the response status was written to the stream
+   */
+  bool started() const { return started_; }
+
   void Start() {
+    started_ = true;
     stream_ << std::hex;
     stream_ << "HTTP/1.1 200 OK\r\nContent-Type: "
                "text/tab-separated-values\r\nTransfer-Encoding: "
@@ -58,7 +71,21 @@ public:
     Send(row);
   }
 
-  void Send(const Row &row) {
+  void Send(const Row &row) { Write(row); }
+
+  void SendView(const RowView &row) { Write(row); }
+
+  void Flush() {
+    if (buf_.tellp() > 0) {
+      stream_ << buf_.tellp() << crlf_;
+      stream_ << buf_.str() << crlf_;
+    }
+    stream_ << 0;
+    stream_ << crlf_ << crlf_;
+  }
+
+private:
+  template <typename R> void Write(const R &row) {
     auto size = row.size();
     for (size_t i = 0; i < size; ++i) {
       if (i > 0) {
@@ -71,26 +98,21 @@ public:
       stream_ << buf_.tellp() << crlf_;
       stream_ << buf_.str() << crlf_;
       buf_.str("");
+      if (on_chunk_) {
+        on_chunk_();
+      }
     }
   }
 
-  void Flush() {
-    if (buf_.tellp() > 0) {
-      stream_ << buf_.tellp() << crlf_;
-      stream_ << buf_.str() << crlf_;
-    }
-    stream_ << 0;
-    stream_ << crlf_ << crlf_;
-  }
-
-private:
   static constexpr const char *crlf_ = "\r\n";
   std::ostream &stream_;
   long long chunk_size_;
   char col_sep_;
   char row_sep_;
+  bool started_;
   std::ostringstream buf_;
   std::unordered_map<std::string, std::string> headers_;
+  std::function<void()> on_chunk_;
 };
 } // namespace http
 } // namespace server
@@ -17,37 +17,117 @@
 #include "server/http/service.h"
 #include "db/database.h"
 #include "db/table.h"
+#include "query/cancel.h"
+#include "query/cursor.h"
 #include "server/http/output.h"
 #include "sql/driver.h"
 #include "util/config.h"
 #include <algorithm>
 #include <boost/exception/diagnostic_information.hpp>
+#include <future>
 #include <glog/logging.h>
+#include <memory>
+#include <sstream>
 
 namespace viya {
 namespace server {
 namespace http {
 
 namespace util = viya::util;
+namespace query = viya::query;
+
+/**
+ * Sends every chunk of the query output as soon as it's ready, and cancels the
+ * query once sending fails, since there's no one to read the result anymore.
+ *
+ * The response buffer is written asynchronously by the server thread, so the
+ * output waits for the chunk to be sent before it writes the next one.
+ */
+static void
+CancelOnDisconnect(ResponsePtr response, ChunkedTsvOutput &output,
+                   std::shared_ptr<query::Cancellation> cancellation) {
+  output.OnChunk([response, cancellation] {
+    auto sent = std::make_shared<std::promise<void>>();
+    auto sent_future = sent->get_future();
+    response->send([cancellation, sent](const SimpleWeb::error_code &ec) {
+      if (ec) {
+        cancellation->Cancel("client disconnected");
+      }
+      sent->set_value();
+    });
+    sent_future.wait();
+  });
+}
+
+/**
+ * Query class set in the query itself overrides the one from request headers
+ */
+static std::string QueryClass(RequestPtr request,
+                              const std::string &query_class) {
+  if (!query_class.empty()) {
+    return query_class;
+  }
+  auto it = request->header.find("X-Query-Priority");
+  return it != request->header.end() ? it->second : std::string();
+}
 
 Service::Service(const util::Config &config, db::Database &database)
-    : database_(database) {
+    : database_(database),
+      ingest_max_pending_(config.num("ingest_max_pending", 268435456L)),
+      ingest_pending_(0) {
   server_.config.port = config.num("http_port");
   server_.config.reuse_address = true;
+  if (config.exists("http_max_request_size")) {
+    server_.config.max_request_streambuf_size =
+        config.num("http_max_request_size");
+  }
 }
 
-void Service::SendError(ResponsePtr response, const std::string &error) {
+void Service::SendError(ResponsePtr response, const std::string &error,
+                        const std::string &status) {
   LOG(ERROR) << error;
-  *response << "HTTP/1.1 400 Bad Request\r\nContent-Length: " << error.size()
+  *response << "HTTP/1.1 " << status << "\r\nContent-Length: " << error.size()
             << "\r\n\r\n"
             << error;
 }
 
+void Service::SendQueryError(ResponsePtr response,
+                             const ChunkedTsvOutput &output,
+                             const std::string &error,
+                             const std::string &status) {
+  if (!output.started()) {
+    SendError(response, error, status);
+    return;
+  }
+  LOG(ERROR) << error;
+  response->close_connection_after_response = true;
+}
+
+void Service::ScheduleQuery(ResponsePtr response,
+                            const std::string &query_class,
+                            std::function<void()> fn) {
+  try {
+    database_.query_scheduler().Enqueue(query_class, fn);
+  } catch (const db::QueryRejected &) {
+    *response << "HTTP/1.1 429 Too Many Requests\r\n"
+                 "Retry-After: 1\r\nContent-Length: 0\r\n\r\n";
+  } catch (const std::exception &e) {
+    SendError(response, e.what());
+  }
+}
+
 void Service::Start() {
   server_.resource["^/tables$"]["POST"] = [&](ResponsePtr response,
                                               RequestPtr request) {
-    auto table_conf = request->content.string();
-    database_.write_pool().enqueue([=] {
+    util::Config table_conf;
+    try {
+      table_conf = util::Config(request->content.string());
+    } catch (const std::exception &e) {
+      SendError(response, e.what());
+      return;
+    }
+    // Writes are serialized per table:
+    database_.write_scheduler().Enqueue(table_conf.str("name", ""), [=] {
       try {
         database_.CreateTable(table_conf);
         *response << "HTTP/1.1 201 OK\r\nContent-Length: 0\r\n\r\n";
@@ -99,8 +179,15 @@ void Service::Start() {
 
   server_.resource["^/load$"]["POST"] = [&](ResponsePtr response,
                                             RequestPtr request) {
-    auto load_conf = request->content.string();
-    database_.write_pool().enqueue([=] {
+    util::Config load_conf;
+    try {
+      load_conf = util::Config(request->content.string());
+    } catch (const std::exception &e) {
+      SendError(response, e.what());
+      return;
+    }
+    // Writes are serialized per table:
+    database_.write_scheduler().Enqueue(load_conf.str("table", ""), [=] {
       try {
         database_.Load(load_conf);
         *response << "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
@@ -112,24 +199,91 @@ void Service::Start() {
     });
   };
 
+  server_.resource["^/ingest/([^/?]+)(\\?.*)?$"]["POST"] =
+      [&](ResponsePtr response, RequestPtr request) {
+        // The body is parsed right from the request content stream, without
+        // copying it. Total amount of data waiting for the write scheduler
+        // is bounded, and clients are asked to retry once the limit is reached:
+        size_t size = request->content.size();
+        size_t pending = ingest_pending_.fetch_add(size);
+        if (pending > 0 && pending + size > ingest_max_pending_) {
+          ingest_pending_ -= size;
+          *response << "HTTP/1.1 503 Service Unavailable\r\n"
+                       "Retry-After: 1\r\nContent-Length: 0\r\n\r\n";
+          return;
+        }
+        std::string table_name = request->path_match[1];
+        database_.write_scheduler().Enqueue(table_name, [=] {
+          try {
+            util::Config load_conf;
+            load_conf.set_str("table", table_name);
+            load_conf.set_str("format", "tsv");
+
+            auto params = request->parse_query_string();
+            auto it = params.find("columns");
+            if (it != params.end()) {
+              std::vector<std::string> columns;
+              std::istringstream ss(it->second);
+              for (std::string col; std::getline(ss, col, ',');) {
+                columns.push_back(col);
+              }
+              load_conf.set_strlist("columns", columns);
+            }
+            it = params.find("batch_id");
+            if (it != params.end()) {
+              load_conf.set_num("batch_id", std::stol(it->second));
+            }
+            it = params.find("idempotency_key");
+            if (it != params.end()) {
+              load_conf.set_str("idempotency_key", it->second);
+            }
+
+            database_.Load(load_conf, request->content);
+            *response << "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+          } catch (const db::BatchAlreadyApplied &e) {
+            SendError(response, e.what(), "409 Conflict");
+          } catch (const std::exception &e) {
+            SendError(response, e.what());
+          } catch (...) {
+            SendError(response,
+                      boost::current_exception_diagnostic_information());
+          }
+          ingest_pending_ -= size;
+        });
+      };
+
   server_.resource["^/query(\\?.*)?$"]["POST"] = [&](ResponsePtr response,
                                                      RequestPtr request) {
-    auto content_string = request->content.string();
-    auto params = request->parse_query_string();
-    database_.read_pool().enqueue([=] {
+    util::Config query_conf;
+    std::string query_class;
+    try {
+      query_conf = util::Config(request->content.string());
+      auto params = request->parse_query_string();
+      if (params.find("header") != params.end()) {
+        query_conf.set_boolean("header", true);
+      }
+      query_class = QueryClass(request, query_conf.str("priority", ""));
+    } catch (const std::exception &e) {
+      SendError(response, e.what());
+      return;
+    }
+    ScheduleQuery(response, query_class, [=] {
+      ChunkedTsvOutput output(*response);
       try {
-        util::Config query_conf(content_string);
-        if (params.find("header") != params.end()) {
-          query_conf.set_boolean("header", true);
-        }
-        ChunkedTsvOutput output(*response);
         output.AddHeader("X-Last-Batch-ID",
                          std::to_string(database_.last_batch_id()));
-        database_.Query(query_conf, output);
+        auto cancellation = std::make_shared<query::Cancellation>();
+        CancelOnDisconnect(response, output, cancellation);
+        database_.Query(query_conf, output, *cancellation);
+      } catch (const query::QueryCancelled &e) {
+        SendQueryError(response, output, e.what(), "504 Gateway Timeout");
+      } catch (const query::CursorExpired &e) {
+        SendQueryError(response, output, e.what(), "410 Gone");
       } catch (const std::exception &e) {
-        SendError(response, e.what());
+        SendQueryError(response, output, e.what());
       } catch (...) {
-        SendError(response, boost::current_exception_diagnostic_information());
+        SendQueryError(response, output,
+                       boost::current_exception_diagnostic_information());
       }
     });
   };
@@ -137,21 +291,26 @@ void Service::Start() {
   server_.resource["^/sql(\\?.*)?$"]["POST"] = [&](ResponsePtr response,
                                                    RequestPtr request) {
     auto sql_query = request->content.string();
-    database_.read_pool().enqueue([=] {
+    ScheduleQuery(response, QueryClass(request, ""), [=] {
+      ChunkedTsvOutput output(*response);
       try {
         auto params = request->parse_query_string();
         bool add_header = params.find("header") != params.end();
         sql::Driver sql_driver(database_, add_header);
-        ChunkedTsvOutput output(*response);
         output.AddHeader("X-Last-Batch-ID",
                          std::to_string(database_.last_batch_id()));
+        auto cancellation = std::make_shared<query::Cancellation>();
+        CancelOnDisconnect(response, output, cancellation);
 
         std::istringstream query(sql_query);
-        sql_driver.Run(query, &output);
+        sql_driver.Run(query, &output, cancellation.get());
+      } catch (const query::QueryCancelled &e) {
+        SendQueryError(response, output, e.what(), "504 Gateway Timeout");
       } catch (const std::exception &e) {
-        SendError(response, e.what());
+        SendQueryError(response, output, e.what());
       } catch (...) {
-        SendError(response, boost::current_exception_diagnostic_information());
+        SendQueryError(response, output,
+                       boost::current_exception_diagnostic_information());
       }
     });
   };
@@ -18,6 +18,8 @@
 #define VIYA_SERVER_HTTP_SERVICE_H_
 
 #include "util/config.h"
+#include <atomic>
+#include <functional>
 #include <server_http.hpp>
 
 namespace viya {
@@ -30,6 +32,8 @@ namespace viya {
 namespace server {
 namespace http {
 
+class ChunkedTsvOutput;
+
 namespace util = viya::util;
 namespace db = viya::db;
 
@@ -44,11 +48,30 @@ public:
   void Start();
 
 private:
-  void SendError(ResponsePtr response, const std::string &error);
+  void SendError(ResponsePtr response, const std::string &error,
+                 const std::string &status = "400 Bad Request");
+
+  /**
+   * Reports an error of a query. If the query output has already started,
+   * the status can't be changed anymore, so the connection is closed instead,
+   * leaving the client with an incomplete response.
+   */
+  void SendQueryError(ResponsePtr response, const ChunkedTsvOutput &output,
+                      const std::string &error,
+                      const std::string &status = "400 Bad Request");
+
+  /**
+   * Runs the query function using the query scheduler, or rejects the request
+   * if there are too many queries of that class waiting
+   */
+  void ScheduleQuery(ResponsePtr response, const std::string &query_class,
+                     std::function<void()> fn);
 
 private:
   db::Database &database_;
   HttpServer server_;
+  size_t ingest_max_pending_;
+  std::atomic<size_t> ingest_pending_;
 };
 } // namespace http
 } // namespace server
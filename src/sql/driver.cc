@@ -63,7 +63,8 @@ void Driver::Parse(std::istream &stream) {
   }
 }
 
-void Driver::Run(std::istream &stream, query::RowOutput *output) {
+void Driver::Run(std::istream &stream, query::RowOutput *output,
+                 query::Cancellation *cancellation) {
   Parse(stream);
 
   for (auto stmt : stmts_) {
@@ -78,7 +79,11 @@ void Driver::Run(std::istream &stream, query::RowOutput *output) {
         throw std::runtime_error("Output handler is not provided");
       }
       DLOG(INFO) << desc.dump();
-      db_.Query(desc, *output);
+      if (cancellation != nullptr) {
+        db_.Query(desc, *output, *cancellation);
+      } else {
+        db_.Query(desc, *output);
+      }
       break;
     case Statement::Type::LOAD:
       db_.Load(desc);
@@ -29,7 +29,8 @@ class Database;
 namespace viya {
 namespace query {
 class RowOutput;
-}
+class Cancellation;
+} // namespace query
 } // namespace viya
 
 namespace viya {
@@ -48,7 +49,8 @@ public:
   Driver(db::Database &db, bool add_header = false);
   ~Driver();
 
-  void Run(std::istream &stream, query::RowOutput *output = nullptr);
+  void Run(std::istream &stream, query::RowOutput *output = nullptr,
+           query::Cancellation *cancellation = nullptr);
   std::vector<util::Config> ParseQueries(std::istream &stream);
   std::vector<Statement> ParseStatements(std::istream &stream);
   void Reset();
@@ -41,7 +41,7 @@ char* dup(const char* str) {
 %token TOK_EOF 0 "end of file"
 %token SELECT SEARCH RAW FROM WHERE BY ORDER HAVING ASC DESC LIMIT OFFSET
 %token AND OR NOT NE LE GE IN BETWEEN SHOW TABLES WORKERS
-%token COPY WITH FORMAT TSV
+%token COPY WITH FORMAT TSV EXPLAIN ANALYZE
 %token <sval> IDENTIFIER STRING FLOATVAL INTVAL
 
 /* Data types */
@@ -89,6 +89,10 @@ statement_list: statement { driver.AddStatement($1); }
 ;
 
 statement: select_statement
+         | EXPLAIN ANALYZE select_statement {
+             $$ = $3;
+             $$->descriptor_["analyze"] = true;
+           }
          | show_statement
          | copy_statement
 ;
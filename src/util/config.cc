@@ -110,6 +110,17 @@ long Config::num(const std::string &key, long default_value) const {
   }
 }
 
+double Config::real(const std::string &key, double default_value) const {
+  if (!exists(key)) {
+    return default_value;
+  }
+  try {
+    return (*conf_)[key].get<double>();
+  } catch (std::exception &e) {
+    throw std::invalid_argument(std::string(key) + ": " + e.what());
+  }
+}
+
 std::vector<long> Config::numlist(const std::string &key) const {
   ValidateKey(key);
   try {
@@ -61,6 +61,8 @@ public:
   void set_num(const std::string &key, long value);
   void set_numlist(const std::string &key, std::vector<long> value);
 
+  double real(const std::string &key, double default_value) const;
+
   bool boolean(const std::string &key) const;
   bool boolean(const std::string &key, bool default_value) const;
   void set_boolean(const std::string &key, bool value);
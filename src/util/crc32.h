@@ -28,10 +28,8 @@ namespace viya {
 namespace util {
 
 /* This one is a Java compatible implementation */
-inline uint32_t crc32(uint32_t crc, const std::string &str) {
-  const unsigned char *buf =
-      reinterpret_cast<const unsigned char *>(str.c_str());
-  size_t len = str.size();
+inline uint32_t crc32(uint32_t crc, const char *str, size_t len) {
+  const unsigned char *buf = reinterpret_cast<const unsigned char *>(str);
   int k;
   crc = ~crc;
   while (len--) {
@@ -42,6 +40,10 @@ inline uint32_t crc32(uint32_t crc, const std::string &str) {
   return ~crc;
 }
 
+inline uint32_t crc32(uint32_t crc, const std::string &str) {
+  return crc32(crc, str.c_str(), str.size());
+}
+
 } // namespace util
 } // namespace viya
 
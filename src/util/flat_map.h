@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2017-present ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIYA_UTIL_FLAT_MAP_H_
+#define VIYA_UTIL_FLAT_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace viya {
+namespace util {
+
+/**
+ * Open addressing hash map, which keeps all the entries in a single vector in
+ * order of insertion. The index table only holds positions of entries along
+ * with upper 32 bits of their hash values, therefore the provided hash function
+ * must distribute well in upper bits.
+ *
+ * Entries are never removed, and iterators are invalidated on every insert.
+ */
+template <typename K, typename V, typename Hash, typename KeyEqual>
+class FlatHashMap {
+public:
+  using value_type = std::pair<K, V>;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  FlatHashMap() : mask_(0) {}
+
+  iterator begin() { return entries_.begin(); }
+  iterator end() { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  /**
+   * Prepares the map for holding the given number of entries without
+   * rehashing.
+   */
+  void reserve(size_t size) {
+    entries_.reserve(size);
+    if (size * 2 > slots_.size()) {
+      Rehash(Capacity(size));
+    }
+  }
+
+  V &operator[](const K &key) { return entries_[Insert(key)].second; }
+
+  std::pair<iterator, bool> emplace(const K &key, const V &value) {
+    size_t size = entries_.size();
+    size_t idx = Insert(key, value);
+    return std::make_pair(entries_.begin() + idx, idx == size);
+  }
+
+  void swap(FlatHashMap &other) {
+    entries_.swap(other.entries_);
+    slots_.swap(other.slots_);
+    std::swap(mask_, other.mask_);
+  }
+
+private:
+  static size_t Capacity(size_t size) {
+    size_t capacity = 16;
+    while (capacity < size * 2) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  /**
+   * Finds the key, or adds it with the value constructed from the given
+   * arguments. The value is only constructed if the key is missing.
+   *
+   * @return index of the entry
+   */
+  template <typename... Args> size_t Insert(const K &key, Args &&... args) {
+    if ((entries_.size() + 1) * 2 > slots_.size()) {
+      Rehash(Capacity(entries_.size() + 1));
+    }
+    uint64_t tag = static_cast<uint64_t>(hash_(key)) >> 32;
+    for (size_t pos = tag & mask_;; pos = (pos + 1) & mask_) {
+      uint64_t slot = slots_[pos];
+      if (slot == 0) {
+        slots_[pos] = (tag << 32) | (entries_.size() + 1);
+        entries_.emplace_back(
+            std::piecewise_construct, std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        return entries_.size() - 1;
+      }
+      size_t idx = static_cast<uint32_t>(slot) - 1;
+      if ((slot >> 32) == tag && equal_(entries_[idx].first, key)) {
+        return idx;
+      }
+    }
+  }
+
+  void Rehash(size_t capacity) {
+    std::vector<uint64_t> slots(capacity, 0);
+    size_t mask = capacity - 1;
+    for (uint64_t slot : slots_) {
+      if (slot != 0) {
+        size_t pos = (slot >> 32) & mask;
+        while (slots[pos] != 0) {
+          pos = (pos + 1) & mask;
+        }
+        slots[pos] = slot;
+      }
+    }
+    slots_.swap(slots);
+    mask_ = mask;
+  }
+
+  std::vector<value_type> entries_;
+  std::vector<uint64_t> slots_; // hash tag in upper bits, entry index + 1
+  size_t mask_;
+  Hash hash_;
+  KeyEqual equal_;
+};
+
+} // namespace util
+} // namespace viya
+
+#endif // VIYA_UTIL_FLAT_MAP_H_
@@ -82,5 +82,29 @@ uint64_t Duration::add_to(uint64_t timestamp, int sign) const {
   return add_to((uint32_t)(timestamp / 1000000L), sign) * 1000000L;
 }
 
+void CalendarBucket::Reset(TimeUnit time_unit, uint64_t secs) {
+  time_t t = (time_t)secs;
+  std::tm tm;
+  gmtime_r(&t, &tm);
+  tm.tm_sec = 0;
+  tm.tm_min = 0;
+  tm.tm_hour = 0;
+  tm.tm_mday = 1;
+  switch (time_unit) {
+  case TimeUnit::YEAR:
+    tm.tm_mon = 0;
+    start_ = timegm(&tm);
+    tm.tm_year += 1;
+    break;
+  case TimeUnit::MONTH:
+    start_ = timegm(&tm);
+    tm.tm_mon += 1;
+    break;
+  default:
+    throw std::runtime_error("Unsupported calendar bucket");
+  }
+  end_ = timegm(&tm);
+}
+
 } // namespace util
 } // namespace viya
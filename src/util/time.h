@@ -17,6 +17,7 @@
 #ifndef VIYA_UTIL_TIME_H_
 #define VIYA_UTIL_TIME_H_
 
+#include "util/likely.h"
 #include <ctime>
 #include <stdint.h>
 #include <string>
@@ -49,93 +50,128 @@ private:
   size_t count_;
 };
 
+// Truncates timestamps (in seconds) to fixed-width time units using integer
+// arithmetic only. Weeks start on Monday.
 class Truncator {
 public:
-  template <TimeUnit U> inline static void trunc(std::tm &tm);
+  template <TimeUnit U> inline static uint64_t trunc(uint64_t secs);
 };
 
-template <> inline void Truncator::trunc<TimeUnit::YEAR>(std::tm &tm) {
-  tm.tm_sec = 0;
-  tm.tm_min = 0;
-  tm.tm_hour = 0;
-  tm.tm_mday = 1;
-  tm.tm_mon = 0;
+template <> inline uint64_t Truncator::trunc<TimeUnit::WEEK>(uint64_t secs) {
+  // Epoch was on Thursday, so shift by 3 days to align weeks with Monday:
+  static const uint64_t shift = 3 * 86400L;
+  return secs + shift < 604800L ? 0L
+                                : (secs + shift) / 604800L * 604800L - shift;
 }
 
-template <> inline void Truncator::trunc<TimeUnit::MONTH>(std::tm &tm) {
-  tm.tm_sec = 0;
-  tm.tm_min = 0;
-  tm.tm_hour = 0;
-  tm.tm_mday = 1;
+template <> inline uint64_t Truncator::trunc<TimeUnit::DAY>(uint64_t secs) {
+  return secs - secs % 86400L;
 }
 
-template <> inline void Truncator::trunc<TimeUnit::DAY>(std::tm &tm) {
-  tm.tm_sec = 0;
-  tm.tm_min = 0;
-  tm.tm_hour = 0;
+template <> inline uint64_t Truncator::trunc<TimeUnit::HOUR>(uint64_t secs) {
+  return secs - secs % 3600L;
 }
 
-template <> inline void Truncator::trunc<TimeUnit::HOUR>(std::tm &tm) {
-  tm.tm_sec = 0;
-  tm.tm_min = 0;
+template <> inline uint64_t Truncator::trunc<TimeUnit::MINUTE>(uint64_t secs) {
+  return secs - secs % 60L;
 }
 
-template <> inline void Truncator::trunc<TimeUnit::MINUTE>(std::tm &tm) {
-  tm.tm_sec = 0;
+template <> inline uint64_t Truncator::trunc<TimeUnit::SECOND>(uint64_t secs) {
+  return secs;
 }
 
-template <>
-inline void Truncator::trunc<TimeUnit::SECOND>(std::tm &tm
-                                               __attribute__((unused))) {}
+// Remembers boundaries of the last calendar bucket (month or year) seen, so
+// truncation of a timestamp falling into the same bucket costs just two
+// comparisons instead of converting it to broken-down time and back.
+class CalendarBucket {
+public:
+  CalendarBucket() : start_(1L), end_(0L) {}
+
+  template <TimeUnit U> uint64_t trunc(uint64_t secs) {
+    if (UNLIKELY(secs < start_ || secs >= end_)) {
+      Reset(U, secs);
+    }
+    return start_;
+  }
+
+private:
+  void Reset(TimeUnit time_unit, uint64_t secs);
+
+private:
+  uint64_t start_;
+  uint64_t end_;
+};
 
 class Time32 {
 public:
-  Time32() : tm_{} {}
+  Time32() : ts_(0L), tm_{} {}
 
   void parse(const char *format, const std::string &value) {
     strptime(value.c_str(), format, &tm_);
+    ts_ = timegm(&tm_);
   }
 
-  void set_ts(uint32_t timestamp) {
-    time_t t = (time_t)timestamp;
-    gmtime_r(&t, &tm_);
-  }
+  void set_ts(uint32_t timestamp) { ts_ = timestamp; }
 
-  uint32_t get_ts() { return timegm(&tm_); }
+  uint32_t get_ts() { return ts_; }
 
-  template <TimeUnit U> void trunc() { Truncator::trunc<U>(tm_); }
+  template <TimeUnit U> void trunc() { ts_ = Truncator::trunc<U>(ts_); }
 
 protected:
+  uint64_t ts_;
+  CalendarBucket month_;
+  CalendarBucket year_;
   std::tm tm_;
 };
 
+template <> inline void Time32::trunc<TimeUnit::MONTH>() {
+  ts_ = month_.trunc<TimeUnit::MONTH>(ts_);
+}
+
+template <> inline void Time32::trunc<TimeUnit::YEAR>() {
+  ts_ = year_.trunc<TimeUnit::YEAR>(ts_);
+}
+
 class Time64 {
 public:
-  Time64() : micros_(0), tm_{} {}
+  Time64() : secs_(0L), micros_(0), tm_{} {}
 
   void parse(const char *format, const std::string &value) {
     strptime(value.c_str(), format, &tm_);
+    secs_ = timegm(&tm_);
     micros_ = 0;
   }
 
   void set_ts(uint64_t timestamp) {
     micros_ = timestamp % 1000000L;
-    time_t t = (time_t)(timestamp / 1000000L);
-    gmtime_r(&t, &tm_);
+    secs_ = timestamp / 1000000L;
   }
 
-  uint64_t get_ts() { return timegm(&tm_) * 1000000L + micros_; }
+  uint64_t get_ts() { return secs_ * 1000000L + micros_; }
 
   template <TimeUnit U> void trunc() {
-    Truncator::trunc<U>(tm_);
+    secs_ = Truncator::trunc<U>(secs_);
     micros_ = 0;
   }
 
 protected:
+  uint64_t secs_;
   uint32_t micros_;
+  CalendarBucket month_;
+  CalendarBucket year_;
   std::tm tm_;
 };
 
+template <> inline void Time64::trunc<TimeUnit::MONTH>() {
+  secs_ = month_.trunc<TimeUnit::MONTH>(secs_);
+  micros_ = 0;
+}
+
+template <> inline void Time64::trunc<TimeUnit::YEAR>() {
+  secs_ = year_.trunc<TimeUnit::YEAR>(secs_);
+  micros_ = 0;
+}
+
 } // namespace util
 } // namespace viya
 
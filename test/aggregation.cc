@@ -20,6 +20,8 @@
 #include "util/config.h"
 #include <algorithm>
 #include <gtest/gtest.h>
+#include <map>
+#include <sstream>
 
 namespace util = viya::util;
 namespace query = viya::query;
@@ -329,3 +331,215 @@ TEST_F(StringDimensions, AggregateQuery) {
       {"a", "b", "c", "d", "3"}};
   EXPECT_EQ(expected, output.rows());
 }
+
+TEST(Aggregation, ParallelScan) {
+  db::Database db(std::move(util::Config(
+      json{{"query_parallelism", 4},
+           {"tables",
+            {{{"name", "events"},
+              {"segment_size", 10},
+              {"dimensions", {{{"name", "country"}}}},
+              {"metrics",
+               {{{"name", "value"}, {"type", "long_sum"}},
+                {{"name", "max_value"}, {"type", "long_max"}},
+                {{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  std::vector<std::string> countries = {"US", "IL", "RU", "KZ", "UK", "DE"};
+  std::stringstream events;
+  std::map<std::string, std::vector<long>> expected_values;
+  for (long i = 0; i < 1000; ++i) {
+    auto &country = countries[i % countries.size()];
+    events << country << "\t" << i << "\t" << i << "\n";
+    auto &values = expected_values[country];
+    values.resize(3);
+    values[0] += i;
+    values[1] = std::max(values[1], i);
+    values[2] += 1;
+  }
+  db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), events);
+
+  std::vector<query::MemoryRowOutput::Row> expected;
+  for (auto &it : expected_values) {
+    expected.push_back({it.first, std::to_string(it.second[0]),
+                        std::to_string(it.second[1]),
+                        std::to_string(it.second[2])});
+  }
+  std::sort(expected.begin(), expected.end());
+
+  // Default parallelism, and explicit per query settings:
+  for (long parallelism : {0, 1, 3}) {
+    json query_conf{{"type", "aggregate"},
+                    {"table", "events"},
+                    {"dimensions", {"country"}},
+                    {"metrics", {"value", "max_value", "count"}}};
+    if (parallelism > 0) {
+      query_conf["parallelism"] = parallelism;
+    }
+    query::MemoryRowOutput output;
+    auto stats = db.Query(std::move(util::Config(query_conf)), output);
+
+    auto actual = output.rows();
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual);
+
+    EXPECT_EQ(1000, stats.scanned_recs);
+    EXPECT_EQ(100, stats.scanned_segments);
+    EXPECT_EQ(countries.size(), stats.aggregated_recs);
+  }
+
+  query::MemoryRowOutput invalid_output;
+  EXPECT_THROW(db.Query(std::move(util::Config(json{
+                            {"type", "aggregate"},
+                            {"table", "events"},
+                            {"dimensions", {"country"}},
+                            {"metrics", {"count"}},
+                            {"parallelism", -1}})),
+                        invalid_output),
+               std::invalid_argument);
+}
+
+TEST(Aggregation, SampledScan) {
+  db::Database db(std::move(util::Config(
+      json{{"tables",
+            {{{"name", "events"},
+              {"segment_size", 10},
+              {"dimensions", {{{"name", "country"}}}},
+              {"metrics",
+               {{{"name", "value"}, {"type", "long_sum"}},
+                {{"name", "max_value"}, {"type", "long_max"}},
+                {{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  std::stringstream events;
+  for (long i = 0; i < 1000; ++i) {
+    events << "US\t1\t" << i << "\n";
+  }
+  db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), events);
+
+  json query_conf{{"type", "aggregate"},
+                  {"table", "events"},
+                  {"dimensions", {"country"}},
+                  {"metrics", {"value", "count"}},
+                  {"sample", 0.2},
+                  {"sample_seed", 42}};
+
+  query::MemoryRowOutput output;
+  auto stats = db.Query(std::move(util::Config(query_conf)), output);
+
+  // All segments are full, so totals are scaled back exactly:
+  std::vector<query::MemoryRowOutput::Row> expected = {{"US", "1000", "1000"}};
+  EXPECT_EQ(expected, output.rows());
+  EXPECT_LT(0, stats.scanned_recs);
+  EXPECT_GT(1000, stats.scanned_recs);
+
+  auto &headers = output.headers();
+  ASSERT_EQ(1, headers.count("X-Sample-Fraction"));
+  EXPECT_DOUBLE_EQ(stats.scanned_recs / 1000.0,
+            std::stod(headers.at("X-Sample-Fraction")));
+  EXPECT_EQ(1, headers.count("X-Sample-Error-value"));
+  EXPECT_EQ(1, headers.count("X-Sample-Error-count"));
+
+  // The same seed gives the same sample:
+  query::MemoryRowOutput same_output;
+  auto same_stats = db.Query(std::move(util::Config(query_conf)), same_output);
+  EXPECT_EQ(stats.scanned_recs, same_stats.scanned_recs);
+
+  // Maximum is not scaled:
+  query_conf["metrics"] = {"max_value"};
+  query::MemoryRowOutput max_output;
+  db.Query(std::move(util::Config(query_conf)), max_output);
+  ASSERT_EQ(1, max_output.rows().size());
+  EXPECT_GT(1000, std::stol(max_output.rows()[0][1]));
+
+  query_conf["sample"] = 1.5;
+  query::MemoryRowOutput invalid_output;
+  EXPECT_THROW(db.Query(std::move(util::Config(query_conf)), invalid_output),
+               std::invalid_argument);
+}
+
+TEST(Aggregation, SmallKeyDomains) {
+  db::Database db(std::move(util::Config(
+      json{{"query_parallelism", 4},
+           {"tables",
+            {{{"name", "events"},
+              {"segment_size", 10},
+              {"dimensions",
+               {{{"name", "country"}, {"cardinality", 10}},
+                {{"name", "is_new"}, {"type", "boolean"}},
+                {{"name", "level"}, {"type", "byte"}}}},
+              {"metrics",
+               {{{"name", "value"}, {"type", "long_sum"}},
+                {{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  std::vector<std::string> countries = {"US", "IL", "RU", "KZ", "UK", "DE"};
+  std::stringstream events;
+  std::map<std::vector<std::string>, std::vector<long>> expected_values;
+  for (long i = 0; i < 1000; ++i) {
+    std::vector<std::string> key = {countries[i % countries.size()],
+                                    i % 2 ? "true" : "false",
+                                    std::to_string(i % 7 - 3)};
+    events << key[0] << "\t" << key[1] << "\t" << key[2] << "\t" << i << "\n";
+    auto &values = expected_values[key];
+    values.resize(2);
+    values[0] += i;
+    values[1] += 1;
+  }
+  db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), events);
+
+  std::vector<query::MemoryRowOutput::Row> expected;
+  for (auto &it : expected_values) {
+    auto row = it.first;
+    row.push_back(std::to_string(it.second[0]));
+    row.push_back(std::to_string(it.second[1]));
+    expected.push_back(row);
+  }
+  std::sort(expected.begin(), expected.end());
+
+  query::MemoryRowOutput output;
+  auto stats = db.Query(
+      std::move(util::Config(
+          json{{"type", "aggregate"},
+               {"table", "events"},
+               {"dimensions", {"country", "is_new", "level"}},
+               {"metrics", {"value", "count"}}})),
+      output);
+
+  auto actual = output.rows();
+  std::sort(actual.begin(), actual.end());
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(expected.size(), stats.aggregated_recs);
+}
+
+TEST(Aggregation, SharedDictionaryKeyDomains) {
+  db::Database db(std::move(util::Config(
+      json{{"tables",
+            {{{"name", "visits"},
+              {"dimensions", {{{"name", "country"}, {"cardinality", 100}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}},
+             {{"name", "events"},
+              {"dimensions", {{{"name", "country"}, {"cardinality", 4}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  // Fill the shared dictionary with more values than "events" may have:
+  std::stringstream visits;
+  for (int i = 0; i < 20; ++i) {
+    visits << "c" << i << "\n";
+  }
+  db.Load(util::Config(json{{"table", "visits"}, {"format", "tsv"}}), visits);
+
+  std::stringstream events;
+  events << "c0\nc17\nc17\nc18\nc19\nc19\nc19\n";
+  db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), events);
+
+  query::MemoryRowOutput output;
+  db.Query(std::move(util::Config(json{{"type", "aggregate"},
+                                       {"table", "events"},
+                                       {"dimensions", {"country"}},
+                                       {"metrics", {"count"}}})),
+           output);
+
+  auto actual = output.rows();
+  std::sort(actual.begin(), actual.end());
+  std::vector<query::MemoryRowOutput::Row> expected = {
+      {"c0", "1"}, {"c17", "2"}, {"c18", "1"}, {"c19", "3"}};
+  EXPECT_EQ(expected, actual);
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017 ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db.h"
+#include "db/table.h"
+#include "query/cancel.h"
+#include "query/output.h"
+#include "util/config.h"
+#include <gtest/gtest.h>
+
+namespace util = viya::util;
+namespace query = viya::query;
+
+class CancelEvents : public testing::Test {
+protected:
+  CancelEvents()
+      : db(std::move(util::Config(json{
+            {"tables",
+             {{{"name", "events"},
+               {"segment_size", 10},
+               {"dimensions", {{{"name", "country"}}}},
+               {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}}))) {
+    std::stringstream events;
+    for (int i = 0; i < 100; ++i) {
+      events << (i % 2 ? "US" : "IL") << "\n";
+    }
+    db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}),
+            events);
+  }
+
+  db::Database db;
+};
+
+TEST_F(CancelEvents, Timeout) {
+  util::Config query_conf(json{{"type", "aggregate"},
+                               {"table", "events"},
+                               {"dimensions", {"country"}},
+                               {"metrics", {"count"}},
+                               {"timeout", 0}});
+
+  query::MemoryRowOutput output;
+  try {
+    db.Query(query_conf, output);
+    FAIL() << "Query must time out";
+  } catch (const query::QueryCancelled &e) {
+    EXPECT_EQ("aggregate", e.stats().query_type_);
+    EXPECT_EQ(0, e.stats().scanned_recs);
+    EXPECT_NE(std::string::npos, std::string(e.what()).find("timeout"));
+  }
+  EXPECT_TRUE(output.rows().empty());
+
+  // Generous timeout doesn't affect the query:
+  query_conf = util::Config(json{{"type", "aggregate"},
+                                 {"table", "events"},
+                                 {"dimensions", {"country"}},
+                                 {"metrics", {"count"}},
+                                 {"timeout", 60000}});
+  query::MemoryRowOutput full_output;
+  auto stats = db.Query(query_conf, full_output);
+  EXPECT_EQ(100, stats.scanned_recs);
+  EXPECT_EQ(2, full_output.rows().size());
+}
+
+TEST_F(CancelEvents, Cancel) {
+  util::Config query_conf(json{{"type", "select"},
+                               {"table", "events"},
+                               {"dimensions", {"country"}},
+                               {"metrics", {"count"}},
+                               {"filter",
+                                {{"op", "eq"},
+                                 {"column", "country"},
+                                 {"value", "US"}}}});
+
+  query::Cancellation cancellation;
+  cancellation.Cancel("stopped by user");
+
+  query::MemoryRowOutput output;
+  EXPECT_THROW(db.Query(query_conf, output, cancellation),
+               query::QueryCancelled);
+
+  query::Cancellation other_cancellation;
+  query::MemoryRowOutput full_output;
+  auto stats = db.Query(query_conf, full_output, other_cancellation);
+  EXPECT_EQ(50, stats.output_recs);
+
+  // Cancellation that comes after the query has completed doesn't fail it:
+  other_cancellation.Cancel("stopped by user");
+  EXPECT_NO_THROW(other_cancellation.Check(stats));
+  EXPECT_TRUE(other_cancellation.cancelled());
+  EXPECT_THROW(other_cancellation.Check(stats), query::QueryCancelled);
+}
@@ -16,7 +16,10 @@
 
 #include "codegen/compiler.h"
 #include "util/config.h"
+#include <chrono>
+#include <cstdlib>
 #include <gtest/gtest.h>
+#include <thread>
 
 namespace cg = viya::codegen;
 namespace util = viya::util;
@@ -32,3 +35,97 @@ TEST(Codegen, Basic) {
 
   EXPECT_EQ(123, func());
 }
+
+TEST(Codegen, TieredCompilation) {
+  std::string code = "int viya_foo() "
+                     "__attribute__((__visibility__(\"default\"))); int "
+                     "viya_foo() { return 123; }";
+  char state_dir[] = "/tmp/viyadb-tiered-XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(state_dir));
+
+  util::Config config;
+  config.set_str("state_dir", state_dir);
+  config.set_num("optimize_after", 2);
+  cg::Compiler compiler(config);
+
+  auto fast_library = compiler.CompileTiered(code);
+  auto func =
+      fast_library->GetFunction<int (*)()>(std::string("_Z8viya_foov"));
+  EXPECT_EQ(123, func());
+
+  auto library = compiler.CompileTiered(code);
+#ifdef NDEBUG
+  // The second execution triggers optimized compilation in background:
+  for (int i = 0; i < 600 && library == fast_library; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    library = compiler.CompileTiered(code);
+  }
+  EXPECT_NE(fast_library, library);
+#endif
+  func = library->GetFunction<int (*)()>(std::string("_Z8viya_foov"));
+  EXPECT_EQ(123, func());
+
+  // Function of the replaced library remains usable while it's referenced:
+  func = fast_library->GetFunction<int (*)()>(std::string("_Z8viya_foov"));
+  EXPECT_EQ(123, func());
+}
+
+TEST(Codegen, CompileWithModule) {
+  std::string module = "inline int viya_bar() { return 7; }";
+  std::string code = "int viya_foo() "
+                     "__attribute__((__visibility__(\"default\"))); int "
+                     "viya_foo() { return viya_bar() * 2; }";
+  char state_dir[] = "/tmp/viyadb-module-XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(state_dir));
+
+  util::Config config;
+  config.set_str("state_dir", state_dir);
+  cg::Compiler compiler(config);
+
+  auto library = compiler.Compile(code, module);
+  auto func = library->GetFunction<int (*)()>(std::string("_Z8viya_foov"));
+  EXPECT_EQ(14, func());
+
+  // The same code compiled against another module is a different library:
+  auto other_library =
+      compiler.Compile(code, "inline int viya_bar() { return 8; }");
+  EXPECT_NE(library, other_library);
+  func = other_library->GetFunction<int (*)()>(std::string("_Z8viya_foov"));
+  EXPECT_EQ(16, func());
+}
+
+TEST(Codegen, LibraryCache) {
+  std::string code = "int viya_foo() "
+                     "__attribute__((__visibility__(\"default\"))); int "
+                     "viya_foo() { return 1; }";
+  std::string other_code = "int viya_foo() "
+                           "__attribute__((__visibility__(\"default\"))); int "
+                           "viya_foo() { return 2; }";
+  char state_dir[] = "/tmp/viyadb-cache-XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(state_dir));
+
+  util::Config config;
+  config.set_str("state_dir", state_dir);
+  config.set_num("max_libraries", 1);
+  config.set_num("optimize_after", 0);
+  cg::Compiler compiler(config);
+
+  // Concurrent compilations of the same code share the library:
+  std::shared_ptr<cg::SharedLibrary> libraries[2];
+  std::thread t1([&]() { libraries[0] = compiler.CompileTiered(code); });
+  std::thread t2([&]() { libraries[1] = compiler.CompileTiered(code); });
+  t1.join();
+  t2.join();
+  EXPECT_EQ(libraries[0], libraries[1]);
+
+  // Loading another library evicts the first one from the cache, but it
+  // remains usable while it's referenced:
+  auto other_library = compiler.CompileTiered(other_code);
+  auto func =
+      libraries[0]->GetFunction<int (*)()>(std::string("_Z8viya_foov"));
+  EXPECT_EQ(1, func());
+  EXPECT_NE(libraries[0], compiler.CompileTiered(code));
+
+  config.set_num("max_libraries", 0);
+  EXPECT_THROW(cg::Compiler{config}, std::invalid_argument);
+}
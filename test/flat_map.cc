@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2017 ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/flat_map.h"
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <unordered_map>
+
+namespace util = viya::util;
+
+struct Key {
+  uint32_t a;
+  uint64_t b;
+
+  // Same hash and equality functors as generated for tuple dimensions:
+  struct KeyEqual {
+    bool operator()(const Key &k1, const Key &k2) const {
+      return k1.a == k2.a && k1.b == k2.b;
+    }
+  };
+
+  struct Hash {
+    std::size_t operator()(const Key &k) const {
+      size_t h = 0L;
+      h = (h ^ (size_t)k.a) * 0x9e3779b97f4a7c15UL;
+      h ^= h >> 32;
+      h = (h ^ (size_t)k.b) * 0x9e3779b97f4a7c15UL;
+      h ^= h >> 32;
+      h ^= h >> 29;
+      h *= 0xbf58476d1ce4e5b9UL;
+      h ^= h >> 32;
+      return h;
+    }
+  };
+};
+
+struct Value {
+  uint64_t count = 0;
+  double sum = 0;
+
+  void Update(const Value &value) {
+    count += value.count;
+    sum += value.sum;
+  }
+};
+
+using FlatMap = util::FlatHashMap<Key, Value, Key::Hash, Key::KeyEqual>;
+using StdMap = std::unordered_map<Key, Value, Key::Hash, Key::KeyEqual>;
+
+TEST(FlatHashMap, InsertAndUpdate) {
+  FlatMap map;
+  Value value{1, 0.5};
+  for (uint32_t i = 0; i < 100000; ++i) {
+    map[Key{i % 1000, i % 3000}].Update(value);
+  }
+  EXPECT_EQ(3000, map.size());
+
+  // Entries are kept in order of insertion:
+  uint64_t i = 0;
+  for (auto &it : map) {
+    EXPECT_EQ(i % 1000, it.first.a);
+    EXPECT_EQ(i, it.first.b);
+    EXPECT_EQ(100000 / 3000 + (i < 100000 % 3000 ? 1 : 0), it.second.count);
+    ++i;
+  }
+
+  auto res = map.emplace(Key{1, 1}, value);
+  EXPECT_FALSE(res.second);
+  EXPECT_EQ(1, res.first->first.b);
+
+  res = map.emplace(Key{1, 3000}, value);
+  EXPECT_TRUE(res.second);
+  EXPECT_EQ(3001, map.size());
+}
+
+TEST(FlatHashMap, ReserveAndSwap) {
+  FlatMap map1, map2;
+  map1.reserve(1000);
+  for (uint32_t i = 0; i < 2000; ++i) {
+    map1[Key{i, i}].count = i;
+  }
+  map1.swap(map2);
+  EXPECT_TRUE(map1.empty());
+  EXPECT_EQ(2000, map2.size());
+  for (uint32_t i = 0; i < 2000; ++i) {
+    auto &value = map2[Key{i, i}];
+    EXPECT_EQ(i, value.count);
+  }
+  EXPECT_EQ(2000, map2.size());
+}
+
+struct CountedValue {
+  static size_t constructed;
+  CountedValue() { ++constructed; }
+};
+size_t CountedValue::constructed = 0;
+
+TEST(FlatHashMap, ConstructValueOnMiss) {
+  util::FlatHashMap<Key, CountedValue, Key::Hash, Key::KeyEqual> map;
+  for (uint32_t i = 0; i < 100; ++i) {
+    map[Key{i % 10, 0}];
+  }
+  EXPECT_EQ(10, map.size());
+  EXPECT_EQ(10, CountedValue::constructed);
+}
+
+template <typename Map> static double AggregateMillis(size_t groups) {
+  auto start = std::chrono::steady_clock::now();
+  Map map;
+  Value value{1, 1.0};
+  for (size_t i = 0; i < groups * 4; ++i) {
+    size_t group = (i * 2654435761UL) % groups;
+    map[Key{static_cast<uint32_t>(group % 1000), group}].Update(value);
+  }
+  double sum = 0;
+  for (auto &it : map) {
+    sum += it.second.sum;
+  }
+  EXPECT_EQ(groups * 4, sum);
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Run with --gtest_also_run_disabled_tests:
+TEST(FlatHashMap, DISABLED_Benchmark) {
+  for (size_t groups = 10000; groups <= 10000000; groups *= 10) {
+    std::cout << groups << " groups: unordered_map "
+              << AggregateMillis<StdMap>(groups) << "ms, flat map "
+              << AggregateMillis<FlatMap>(groups) << "ms" << std::endl;
+  }
+}
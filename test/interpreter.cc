@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2017 ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db.h"
+#include "db/table.h"
+#include "input/simple.h"
+#include "query/output.h"
+#include "util/config.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+
+namespace util = viya::util;
+namespace query = viya::query;
+
+class InterpretedEvents : public testing::Test {
+protected:
+  InterpretedEvents()
+      : db(std::move(util::Config(
+            json{{"interpret_queries", true},
+                 {"tables",
+                  {{{"name", "events"},
+                    {"dimensions",
+                     {{{"name", "country"}},
+                      {{"name", "event_name"}, {"length", 20}},
+                      {{"name", "install_time"}, {"type", "uint"}}}},
+                    {"metrics",
+                     {{{"name", "count"}, {"type", "count"}},
+                      {{"name", "revenue"}, {"type", "double_sum"}},
+                      {{"name", "max_revenue"},
+                       {"type", "double_max"}}}}}}}}))) {}
+
+  void LoadEvents() {
+    auto table = db.GetTable("events");
+    input::SimpleLoader loader(*table);
+    loader.Load({{"US", "purchase", "20141110", "0.1", "0.1"},
+                 {"IL", "refund", "20141111", "1.01", "1.01"},
+                 {"CH", "refund", "20141111", "1.1", "1.1"},
+                 {"AZ", "refund", "20141111", "1.1", "1.1"},
+                 {"RU", "donate", "20141112", "1.0", "1.0"},
+                 {"US", "review", "20141113", "5.0", "5.0"},
+                 {"US", "purchase", "20141113", "2.0", "2.0"}});
+  }
+
+  db::Database db;
+};
+
+TEST_F(InterpretedEvents, AggregateQuery) {
+  LoadEvents();
+
+  util::Config query_conf(json{
+      {"type", "aggregate"},
+      {"table", "events"},
+      {"dimensions", {"country"}},
+      {"metrics", {"count", "revenue", "max_revenue"}},
+      {"filter", {{"op", "ne"}, {"column", "event_name"}, {"value", "donate"}}},
+      {"having", {{"op", "gt"}, {"column", "revenue"}, {"value", "1.05"}}},
+      {"sort", {{{"column", "revenue"}}, {{"column", "country"}}}},
+      {"skip", 1},
+      {"limit", 2}});
+
+  std::vector<query::MemoryRowOutput::Row> expected = {
+      {"CH", "1", "1.1", "1.1"}, {"AZ", "1", "1.1", "1.1"}};
+
+  // The first query is interpreted, while the following ones run compiled
+  // code once it's ready. All of them must return the same result:
+  for (int i = 0; i < 2; ++i) {
+    query::MemoryRowOutput output;
+    db.Query(query_conf, output);
+    EXPECT_EQ(expected, output.rows());
+  }
+}
+
+TEST_F(InterpretedEvents, SelectQuery) {
+  LoadEvents();
+
+  util::Config query_conf(json{
+      {"type", "select"},
+      {"table", "events"},
+      {"dimensions", {"country", "event_name"}},
+      {"metrics", {"revenue"}},
+      {"filter",
+       {{"op", "and"},
+        {"filters",
+         {{{"op", "in"}, {"column", "country"}, {"values", {"US", "IL"}}},
+          {{"op", "ge"}, {"column", "install_time"}, {"value", "20141111"}}}}}},
+      {"skip", 1},
+      {"limit", 1}});
+
+  std::vector<query::MemoryRowOutput::Row> expected = {{"US", "review", "5"}};
+
+  for (int i = 0; i < 2; ++i) {
+    query::MemoryRowOutput output;
+    db.Query(query_conf, output);
+    EXPECT_EQ(expected, output.rows());
+  }
+}
+
+TEST_F(InterpretedEvents, SearchQuery) {
+  LoadEvents();
+
+  util::Config query_conf(json{
+      {"type", "search"},
+      {"table", "events"},
+      {"dimension", "event_name"},
+      {"term", "r"},
+      {"limit", 10},
+      {"filter", {{"op", "gt"}, {"column", "revenue"}, {"value", "1.0"}}}});
+
+  std::vector<std::string> expected = {"purchase", "refund", "review"};
+
+  for (int i = 0; i < 2; ++i) {
+    query::MemoryRowOutput output;
+    db.Query(query_conf, output);
+    ASSERT_EQ(1, output.rows().size());
+    auto actual = output.rows()[0];
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual);
+  }
+}
@@ -17,11 +17,16 @@
 #include "db.h"
 #include "db/store.h"
 #include "db/table.h"
+#include "db/write_scheduler.h"
 #include "input/simple.h"
 #include <boost/filesystem.hpp>
 #include <chrono>
 #include <fstream>
+#include <future>
 #include <gtest/gtest.h>
+#include <numeric>
+#include <sstream>
+#include <thread>
 #include <unistd.h>
 #include <util/scope_guard.h>
 
@@ -142,6 +147,107 @@ TEST_F(InappEvents, LoadFromTsvCols) {
   EXPECT_EQ(expected, output.rows());
 }
 
+TEST_F(InappEvents, LoadBatchOnce) {
+  auto table = db.GetTable("events");
+  std::string fname("InappEvents_LoadBatchOnce.tsv");
+  std::ofstream out(fname);
+  out << "US\tpurchase\t20141112\t0.1\n";
+  out << "US\tpurchase\t20141112\t1.1\n";
+  out.close();
+  util::ScopeGuard cleanup = [&fname]() { unlink(fname.c_str()); };
+
+  util::Config load_conf(json{{"file", fname},
+                              {"type", "file"},
+                              {"format", "tsv"},
+                              {"batch_id", 1},
+                              {"table", table->name()}});
+  db.Load(load_conf);
+  // Replayed batch must be skipped:
+  db.Load(load_conf);
+
+  // Same file in another batch is a new input:
+  load_conf.set_num("batch_id", 2);
+  db.Load(load_conf);
+  EXPECT_EQ(2, db.last_batch_id());
+
+  query::MemoryRowOutput output;
+  db.Query(std::move(util::Config(json{{"type", "aggregate"},
+                                       {"table", "events"},
+                                       {"dimensions", {"country"}},
+                                       {"metrics", {"revenue"}}})),
+           output);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {{"US", "2.4"}};
+  EXPECT_EQ(expected, output.rows());
+}
+
+TEST_F(InappEvents, LoadFromStream) {
+  auto table = db.GetTable("events");
+  std::istringstream in("US\tpurchase\t20141112\t0.1\n"
+                        "US\tpurchase\t20141112\t1.1\n"
+                        "US\t\t20141112\t0.3\n"
+                        "IL\tpurchase\t20141112\t0.0");
+
+  // Block size is smaller than the input, so lines are split across blocks:
+  util::Config load_conf(json{
+      {"format", "tsv"}, {"block_size", 40}, {"table", table->name()}});
+  db.Load(load_conf, in);
+
+  EXPECT_EQ(1, table->store()->segments().size());
+  EXPECT_EQ(3, table->store()->segments()[0]->size());
+
+  query::MemoryRowOutput output;
+  db.Query(
+      std::move(util::Config(json{
+          {"type", "aggregate"},
+          {"table", "events"},
+          {"dimensions", {"country"}},
+          {"metrics", {"revenue"}},
+          {"filter", {{"op", "ne"}, {"column", "country"}, {"value", "IL"}}}})),
+      output);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {{"US", "1.5"}};
+  EXPECT_EQ(expected, output.rows());
+}
+
+TEST_F(InappEvents, LoadStreamBatchOnce) {
+  auto table = db.GetTable("events");
+  util::Config load_conf(
+      json{{"format", "tsv"}, {"batch_id", 1}, {"table", table->name()}});
+
+  // Streams without an idempotency key are never skipped:
+  std::istringstream first("US\tpurchase\t20141112\t0.1\n");
+  db.Load(load_conf, first);
+  std::istringstream second("US\tpurchase\t20141112\t1.1\n");
+  db.Load(load_conf, second);
+
+  // Replayed idempotency key is rejected:
+  load_conf.set_str("idempotency_key", "producer-1");
+  std::istringstream third("US\tpurchase\t20141112\t1.0\n");
+  db.Load(load_conf, third);
+  std::istringstream replayed("US\tpurchase\t20141112\t1.0\n");
+  EXPECT_THROW(db.Load(load_conf, replayed), db::BatchAlreadyApplied);
+
+  query::MemoryRowOutput output;
+  db.Query(std::move(util::Config(json{{"type", "aggregate"},
+                                       {"table", "events"},
+                                       {"dimensions", {"country"}},
+                                       {"metrics", {"revenue"}}})),
+           output);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {{"US", "2.2"}};
+  EXPECT_EQ(expected, output.rows());
+}
+
+TEST_F(InappEvents, LoadFromStreamLongLine) {
+  auto table = db.GetTable("events");
+  std::istringstream in("US\tpurchase\t20141112\t0.1\n");
+
+  util::Config load_conf(json{
+      {"format", "tsv"}, {"block_size", 10}, {"table", table->name()}});
+  EXPECT_THROW(db.Load(load_conf, in), std::runtime_error);
+}
+
 TEST_F(InappEvents, LoadFromTsvColsMapping) {
   std::string fname("InappEvents_LoadFromTsvColsMapping.tsv");
   std::ofstream out(fname);
@@ -230,3 +336,88 @@ TEST(Watch, LoadEvents) {
       {"IL", "purchase", "1"}, {"US", "purchase", "2"}, {"US", "sell", "1"}};
   EXPECT_EQ(expected, output.rows());
 }
+
+TEST(Load, SharedDictionaryConcurrently) {
+  db::Database db(std::move(util::Config(
+      json{{"tables",
+            {{{"name", "events"},
+              {"dimensions", {{{"name", "country"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}},
+             {{"name", "users"},
+              {"dimensions", {{{"name", "country"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  // Both tables add the same values into the shared dictionary at once:
+  auto load = [&db](const std::string &table) {
+    std::stringstream rows;
+    for (int i = 0; i < 20000; ++i) {
+      rows << "c" << (i % 5000) << "\n";
+    }
+    db.Load(util::Config(json{{"table", table}, {"format", "tsv"}}), rows);
+  };
+  std::thread events_loader(load, "events");
+  std::thread users_loader(load, "users");
+  events_loader.join();
+  users_loader.join();
+
+  for (auto table : {"events", "users"}) {
+    query::MemoryRowOutput output;
+    db.Query(std::move(util::Config(json{{"type", "aggregate"},
+                                         {"table", table},
+                                         {"dimensions", {"country"}},
+                                         {"metrics", {"count"}}})),
+             output);
+
+    // Every value must have a single code:
+    auto rows = output.rows();
+    ASSERT_EQ(5000, rows.size());
+    for (auto &row : rows) {
+      EXPECT_EQ("4", row[1]);
+    }
+  }
+}
+
+TEST(WriteScheduler, OrderWithinLane) {
+  util::Statsd statsd;
+  db::WriteScheduler scheduler(4, statsd);
+
+  std::vector<int> order;
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < 100; ++i) {
+    futures.push_back(scheduler.Enqueue("events", [&order, i] {
+      std::this_thread::sleep_for(std::chrono::microseconds(100 - i));
+      order.push_back(i);
+    }));
+  }
+  for (auto &f : futures) {
+    f.get();
+  }
+
+  std::vector<int> expected(100);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(expected, order);
+}
+
+TEST(WriteScheduler, IndependentLanes) {
+  util::Statsd statsd;
+  db::WriteScheduler scheduler(2, statsd);
+
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  auto blocked = scheduler.Enqueue("events", [released] { released.wait(); });
+  auto queued = scheduler.Enqueue("events", [] {});
+
+  // Write into another table completes while the first one is busy:
+  auto other = scheduler.Enqueue("users", [] {});
+  EXPECT_EQ(std::future_status::ready,
+            other.wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(2, scheduler.queue_depth("events"));
+
+  release.set_value();
+  blocked.get();
+  queued.get();
+
+  // Task's future gets ready before the task leaves its lane:
+  scheduler.WaitIdle();
+  EXPECT_EQ(0, scheduler.queue_depth("events"));
+}
@@ -14,15 +14,21 @@
  * limitations under the License.
  */
 
+#include "cluster/splitter.h"
 #include "db.h"
 #include "db/table.h"
 #include "query/output.h"
 #include "util/config.h"
+#include "util/scope_guard.h"
 #include <algorithm>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <iterator>
+#include <unistd.h>
 
 namespace util = viya::util;
 namespace query = viya::query;
+namespace cluster = viya::cluster;
 
 TEST_F(MultiTenantEvents, PartitionBySingleColumn) {
   LoadEvents(util::Config(json{
@@ -66,3 +72,53 @@ TEST_F(MultiTenantEvents, PartitionByMultiColumn) {
 
   EXPECT_EQ(expected, actual);
 }
+
+TEST_F(MultiTenantEvents, SplitByPartitions) {
+  std::string input = "com.bee\tUS\tpurchase\t1495475514\t15\n"
+                      "com.bee\tRU\tsupport\t1495475517\t23\n"
+                      "com.horse\tUS\topenapp\t1495475632\t137\n"
+                      "com.horse\tIL\tpurchase\t1495475715\t148\n"
+                      "com.horse\tKZ\tcloseapp\t1495475716\t19\n"
+                      "com.bird\tUS\tuninstall\t1495475809\t35\n"
+                      "com.bird\tKZ\tpurchase\t1495475808\t231\n"
+                      "com.bird\tUS\tpurchase\t1495476000\t32";
+
+  // Partitions 0 and 1 are collocated, and partition 4 is not requested:
+  cluster::PartitionSplitter splitter({0, 1}, {0, 0, 2, 3, 4}, 5, 64);
+  auto files = splitter.Split(input.c_str(), input.size(), {0, 2, 3});
+  util::ScopeGuard cleanup = [&files]() {
+    for (auto &it : files) {
+      unlink(it.second.c_str());
+    }
+  };
+  ASSERT_EQ(3, files.size());
+
+  size_t total_rows = 0;
+  for (auto &it : files) {
+    std::ifstream in(it.second);
+    total_rows += std::count(std::istreambuf_iterator<char>(in),
+                             std::istreambuf_iterator<char>(), '\n');
+  }
+  EXPECT_EQ(4, total_rows);
+
+  db.Load(util::Config(json{{"file", files.at(3)},
+                            {"type", "file"},
+                            {"format", "tsv"},
+                            {"table", "events"}}));
+
+  query::MemoryRowOutput output;
+  db.Query(std::move(util::Config(json{{"type", "aggregate"},
+                                       {"table", "events"},
+                                       {"dimensions", {"app_id", "country"}},
+                                       {"metrics", {"count"}}})),
+           output);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {
+      {"com.bee", "RU", "1"}, {"com.horse", "IL", "1"}};
+  std::sort(expected.begin(), expected.end());
+
+  auto actual = output.rows();
+  std::sort(actual.begin(), actual.end());
+
+  EXPECT_EQ(expected, actual);
+}
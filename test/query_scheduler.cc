@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2017 ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db.h"
+#include "db/query_scheduler.h"
+#include "util/config.h"
+#include "util/statsd.h"
+#include <ThreadPool/ThreadPool.h>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace util = viya::util;
+
+static util::Config QueryClasses() {
+  return util::Config(
+      json{{"query_classes",
+            {{{"name", "interactive"}, {"priority", 0}},
+             {{"name", "batch"},
+              {"priority", 1},
+              {"max_concurrent", 1},
+              {"max_queued", 2}}}}});
+}
+
+TEST(QueryScheduler, Priority) {
+  util::Statsd statsd;
+  ThreadPool pool(1);
+  db::QueryScheduler scheduler(QueryClasses(), pool, 1, statsd);
+  EXPECT_EQ("interactive", scheduler.default_class());
+
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  auto blocked = scheduler.Enqueue("batch", [released] { released.wait(); });
+
+  // Interactive query overtakes the batch one that was queued earlier:
+  std::vector<std::string> order;
+  auto batch = scheduler.Enqueue("batch", [&order] { order.push_back("b"); });
+  auto interactive = scheduler.Enqueue("", [&order] { order.push_back("i"); });
+  EXPECT_EQ(1, scheduler.queue_depth("batch"));
+  EXPECT_EQ(1, scheduler.queue_depth("interactive"));
+
+  release.set_value();
+  blocked.get();
+  batch.get();
+  interactive.get();
+
+  std::vector<std::string> expected = {"i", "b"};
+  EXPECT_EQ(expected, order);
+}
+
+TEST(QueryScheduler, Limits) {
+  util::Statsd statsd;
+  ThreadPool pool(2);
+  db::QueryScheduler scheduler(QueryClasses(), pool, 2, statsd);
+
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  auto blocked = scheduler.Enqueue("batch", [released] { released.wait(); });
+
+  // Only one batch query runs at a time, while interactive ones aren't
+  // affected:
+  auto queued1 = scheduler.Enqueue("batch", [] {});
+  auto queued2 = scheduler.Enqueue("batch", [] {});
+  auto interactive = scheduler.Enqueue("interactive", [] {});
+  EXPECT_EQ(std::future_status::ready,
+            interactive.wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(2, scheduler.queue_depth("batch"));
+
+  // The queue is full:
+  EXPECT_THROW(scheduler.Enqueue("batch", [] {}), db::QueryRejected);
+  EXPECT_THROW(scheduler.Enqueue("unknown", [] {}), std::invalid_argument);
+
+  release.set_value();
+  blocked.get();
+  queued1.get();
+  queued2.get();
+  EXPECT_EQ(0, scheduler.queue_depth("batch"));
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2017 ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db.h"
+#include "db/table.h"
+#include "input/simple.h"
+#include "query/output.h"
+#include "util/config.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+namespace util = viya::util;
+namespace query = viya::query;
+
+class CachedEvents : public testing::Test {
+protected:
+  CachedEvents()
+      : db(std::move(util::Config(json{
+            {"result_cache_size", 1024 * 1024},
+            {"tables",
+             {{{"name", "events"},
+               {"dimensions", {{{"name", "country"}}}},
+               {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}}))) {}
+
+  void LoadEvents(std::initializer_list<std::vector<std::string>> events) {
+    input::SimpleLoader loader(*db.GetTable("events"));
+    loader.Load(events);
+  }
+
+  db::Database db;
+};
+
+TEST_F(CachedEvents, ReuseUntilLoad) {
+  LoadEvents({{"US"}, {"US"}, {"IL"}});
+
+  util::Config query_conf(json{{"type", "aggregate"},
+                               {"table", "events"},
+                               {"dimensions", {"country"}},
+                               {"metrics", {"count"}},
+                               {"sort", {{{"column", "country"}}}}});
+
+  std::vector<query::MemoryRowOutput::Row> expected = {{"US", "2"},
+                                                       {"IL", "1"}};
+  query::MemoryRowOutput output;
+  db.Query(query_conf, output);
+  EXPECT_EQ(expected, output.rows());
+  auto cache_size = db.result_cache().size();
+  EXPECT_LT(0, cache_size);
+
+  query::MemoryRowOutput cached_output;
+  db.Query(query_conf, cached_output);
+  EXPECT_EQ(expected, cached_output.rows());
+  EXPECT_EQ(cache_size, db.result_cache().size());
+
+  // Loading changes the table version, so the query runs again:
+  LoadEvents({{"IL"}, {"IL"}});
+  expected = {{"US", "2"}, {"IL", "3"}};
+  query::MemoryRowOutput new_output;
+  db.Query(query_conf, new_output);
+  EXPECT_EQ(expected, new_output.rows());
+}
+
+TEST_F(CachedEvents, ReuseAfterFailedLoad) {
+  LoadEvents({{"US"}, {"IL"}});
+
+  // Failed load doesn't leave the table marked as being written:
+  std::istringstream in("US\n"
+                        "US\tIL\tRU\tKZ\n");
+  EXPECT_THROW(
+      db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), in),
+      std::exception);
+  EXPECT_FALSE(db.GetTable("events")->writing());
+
+  util::Config query_conf(json{{"type", "aggregate"},
+                               {"table", "events"},
+                               {"dimensions", {"country"}},
+                               {"metrics", {"count"}}});
+  query::MemoryRowOutput output;
+  db.Query(query_conf, output);
+  auto cache_size = db.result_cache().size();
+  EXPECT_LT(0, cache_size);
+
+  query::MemoryRowOutput cached_output;
+  db.Query(query_conf, cached_output);
+  EXPECT_EQ(output.rows(), cached_output.rows());
+  EXPECT_EQ(cache_size, db.result_cache().size());
+}
@@ -92,3 +92,83 @@ TEST_F(SearchEvents, SearchQueryLimit) {
 
   EXPECT_EQ(expected, actual);
 }
+
+TEST(Search, DictionaryOnly) {
+  db::Database db(std::move(util::Config(
+      json{{"tables",
+            {{{"name", "events"},
+              {"dimensions", {{{"name", "event_name"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}},
+             {{"name", "other"},
+              {"dimensions", {{{"name", "country"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}},
+             {{"name", "more"},
+              {"dimensions", {{{"name", "country"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  input::SimpleLoader events_loader(*db.GetTable("events"));
+  events_loader.Load(
+      {{"purchase"}, {"refund"}, {"purchase"}, {"review"}, {"donate"}});
+
+  query::MemoryRowOutput output;
+  auto stats = db.Query(std::move(util::Config(json{{"type", "search"},
+                                                    {"table", "events"},
+                                                    {"dimension", "event_name"},
+                                                    {"term", "r"}})),
+                        output);
+
+  // Values are found in the dictionary without scanning segments:
+  std::vector<query::MemoryRowOutput::Row> expected = {
+      {"purchase", "refund", "review"}};
+  auto actual = output.rows();
+  std::sort(actual[0].begin(), actual[0].end());
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(0, stats.scanned_recs);
+
+  // Dictionary shared with another table may hold values of that table:
+  input::SimpleLoader other_loader(*db.GetTable("other"));
+  other_loader.Load({{"US"}, {"IL"}});
+  input::SimpleLoader more_loader(*db.GetTable("more"));
+  more_loader.Load({{"UK"}});
+
+  query::MemoryRowOutput shared_output;
+  auto shared_stats =
+      db.Query(std::move(util::Config(json{{"type", "search"},
+                                           {"table", "more"},
+                                           {"dimension", "country"},
+                                           {"term", "U"}})),
+               shared_output);
+
+  expected = {{"UK"}};
+  EXPECT_EQ(expected, shared_output.rows());
+  EXPECT_EQ(1, shared_stats.scanned_recs);
+}
+
+TEST(Search, CardinalityGuard) {
+  db::Database db(std::move(util::Config(
+      json{{"tables",
+            {{{"name", "events"},
+              {"dimensions",
+               {{{"name", "device_id"}},
+                {{"name", "event_name"},
+                 {"cardinality_guard",
+                  {{"dimensions", {"device_id"}}, {"limit", 3}}}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  input::SimpleLoader loader(*db.GetTable("events"));
+  loader.Load({{"13873844", "purchase"},
+               {"13873844", "open-app"},
+               {"13873844", "close-app"},
+               {"13873844", "review"}});
+
+  query::MemoryRowOutput output;
+  db.Query(std::move(util::Config(json{{"type", "search"},
+                                       {"table", "events"},
+                                       {"dimension", "event_name"},
+                                       {"term", "r"}})),
+           output);
+
+  // Value rejected by the guard is in the dictionary, but not in the table:
+  std::vector<query::MemoryRowOutput::Row> expected = {{"purchase"}};
+  EXPECT_EQ(expected, output.rows());
+}
@@ -16,10 +16,12 @@
 
 #include "db.h"
 #include "db/table.h"
+#include "query/cursor.h"
 #include "query/output.h"
 #include "util/config.h"
 #include <algorithm>
 #include <gtest/gtest.h>
+#include <sstream>
 
 namespace util = viya::util;
 namespace query = viya::query;
@@ -109,3 +111,142 @@ TEST_F(SelectEvents, QueryWithSkip) {
 
   EXPECT_EQ(expected, actual);
 }
+
+TEST(Select, FilterAcrossSegments) {
+  db::Database db(std::move(util::Config(
+      json{{"tables",
+            {{{"name", "events"},
+              {"segment_size", 3000},
+              {"dimensions", {{{"name", "id"}, {"type", "uint"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  std::stringstream events;
+  for (long i = 0; i < 10000; ++i) {
+    events << i << "\n";
+  }
+  db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), events);
+
+  query::MemoryRowOutput output;
+  auto stats = db.Query(
+      std::move(util::Config(
+          json{{"type", "select"},
+               {"table", "events"},
+               {"dimensions", {"id"}},
+               {"filter", {{"op", "ge"}, {"column", "id"}, {"value", "2000"}}},
+               {"limit", 2000}})),
+      output);
+
+  // Selected rows cross both scan block and segment boundaries, and the limit
+  // must stop the scan in the middle of a segment:
+  std::vector<query::MemoryRowOutput::Row> expected;
+  for (long i = 2000; i < 4000; ++i) {
+    expected.push_back({std::to_string(i)});
+  }
+
+  auto actual = output.rows();
+
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(2000, stats.output_recs);
+}
+
+TEST(Select, StringsAcrossBatches) {
+  db::Database db(std::move(util::Config(
+      json{{"tables",
+            {{{"name", "events"},
+              {"dimensions",
+               {{{"name", "id"}, {"type", "uint"}}, {{"name", "name"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  // Values repeat within every decoded batch:
+  std::stringstream events;
+  for (long i = 0; i < 2500; ++i) {
+    events << i << "\tname" << (i % 7) << "\n";
+  }
+  db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), events);
+
+  query::MemoryRowOutput output;
+  db.Query(std::move(util::Config(json{{"type", "select"},
+                                       {"table", "events"},
+                                       {"dimensions", {"name", "id", "name"}},
+                                       {"metrics", {"count"}}})),
+           output);
+
+  std::vector<query::MemoryRowOutput::Row> expected;
+  for (long i = 0; i < 2500; ++i) {
+    auto name = "name" + std::to_string(i % 7);
+    expected.push_back({name, std::to_string(i), name, "1"});
+  }
+
+  auto actual = output.rows();
+  std::sort(actual.begin(), actual.end(),
+            [](auto &a, auto &b) { return std::stol(a[1]) < std::stol(b[1]); });
+
+  EXPECT_EQ(expected, actual);
+}
+
+TEST(Select, PaginateWithCursor) {
+  db::Database db(std::move(util::Config(
+      json{{"tables",
+            {{{"name", "events"},
+              {"segment_size", 7},
+              {"dimensions", {{{"name", "id"}, {"type", "uint"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}},
+             {{"name", "other"},
+              {"dimensions", {{{"name", "id"}, {"type", "uint"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}})));
+
+  std::stringstream events;
+  for (long i = 0; i < 50; ++i) {
+    events << i << "\n";
+  }
+  db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), events);
+
+  json query_conf{{"type", "select"},
+                  {"table", "events"},
+                  {"dimensions", {"id"}},
+                  {"filter", {{"op", "ge"}, {"column", "id"}, {"value", "5"}}},
+                  {"limit", 10},
+                  {"cursor", ""}};
+
+  // Pages continue from where the previous ones have stopped:
+  std::vector<query::MemoryRowOutput::Row> actual;
+  size_t pages = 0;
+  std::string first_cursor;
+  while (true) {
+    query::MemoryRowOutput output;
+    auto stats = db.Query(std::move(util::Config(query_conf)), output);
+    ++pages;
+    actual.insert(actual.end(), output.rows().begin(), output.rows().end());
+
+    // Rows of previous pages are not scanned again:
+    EXPECT_GE(21, stats.scanned_recs);
+
+    auto it = output.headers().find("X-Next-Cursor");
+    if (it == output.headers().end()) {
+      break;
+    }
+    if (first_cursor.empty()) {
+      first_cursor = it->second;
+    }
+    query_conf["cursor"] = it->second;
+  }
+
+  std::vector<query::MemoryRowOutput::Row> expected;
+  for (long i = 5; i < 50; ++i) {
+    expected.push_back({std::to_string(i)});
+  }
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(5, pages);
+
+  // Cursor is only valid for the segments it was taken from:
+  query_conf["table"] = "other";
+  query_conf["cursor"] = first_cursor;
+  query::MemoryRowOutput expired_output;
+  EXPECT_THROW(db.Query(std::move(util::Config(query_conf)), expired_output),
+               query::CursorExpired);
+
+  query_conf["cursor"] = "garbage";
+  query::MemoryRowOutput invalid_output;
+  EXPECT_THROW(db.Query(std::move(util::Config(query_conf)), invalid_output),
+               std::invalid_argument);
+}
@@ -21,6 +21,7 @@
 #include "util/config.h"
 #include <algorithm>
 #include <gtest/gtest.h>
+#include <sstream>
 
 namespace util = viya::util;
 namespace query = viya::query;
@@ -112,3 +113,58 @@ TEST_F(SortEvents, LimitGreaterThanResult) {
 
   EXPECT_EQ(expected, output.rows());
 }
+
+TEST_F(SortEvents, TopNWithSkipAndHaving) {
+  LoadSortEvents();
+
+  query::MemoryRowOutput output;
+  db.Query(std::move(util::Config(json{
+               {"type", "aggregate"},
+               {"table", "events"},
+               {"dimensions", {"country"}},
+               {"metrics", {"revenue"}},
+               {"having",
+                {{"op", "gt"}, {"column", "revenue"}, {"value", "1"}}},
+               {"sort",
+                {{{"column", "revenue"}},
+                 {{"column", "country"}, {"ascending", true}}}},
+               {"skip", 1},
+               {"limit", 5}})),
+           output);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {
+      {"AZ", "1.1"}, {"CH", "1.1"}, {"IL", "1.01"}};
+
+  EXPECT_EQ(expected, output.rows());
+}
+
+TEST(Sort, LargeResult) {
+  db::Database db(std::move(util::Config(
+      json{{"query_parallelism", 4},
+           {"tables",
+            {{{"name", "events"},
+              {"dimensions", {{{"name", "id"}, {"type", "uint"}}}},
+              {"metrics", {{{"name", "value"}, {"type", "long_sum"}}}}}}}})));
+
+  std::stringstream events;
+  for (long i = 0; i < 200000; ++i) {
+    events << i << "\t" << (i * 7919) % 200000 - 100000 << "\n";
+  }
+  db.Load(util::Config(json{{"table", "events"}, {"format", "tsv"}}), events);
+
+  query::MemoryRowOutput output;
+  db.Query(std::move(util::Config(
+               json{{"type", "aggregate"},
+                    {"table", "events"},
+                    {"dimensions", {"id"}},
+                    {"metrics", {"value"}},
+                    {"sort", {{{"column", "value"}, {"ascending", true}}}},
+                    {"skip", 10}})),
+           output);
+
+  auto rows = output.rows();
+  ASSERT_EQ(199990, rows.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    ASSERT_EQ(std::to_string(i + 10 - 100000), rows[i][1]);
+  }
+}
@@ -21,6 +21,7 @@
 #include "sql/driver.h"
 #include "util/config.h"
 #include <fstream>
+#include <map>
 #include <gtest/gtest.h>
 #include <sstream>
 
@@ -440,3 +441,35 @@ TEST_F(SqlEvents, SupportHypens) {
 
   EXPECT_EQ(expected, actual);
 }
+
+TEST_F(SqlEvents, ExplainAnalyze) {
+  LoadEvents();
+
+  query::MemoryRowOutput output;
+  sql::Driver sql_driver(db);
+
+  std::istringstream query("EXPLAIN ANALYZE SELECT country,revenue FROM events "
+                           "ORDER BY revenue DESC LIMIT 1;");
+  sql_driver.Run(query, &output);
+
+  // Query rows are replaced with the report:
+  std::map<std::string, std::string> report;
+  for (auto &row : output.rows()) {
+    ASSERT_EQ(2, row.size());
+    report[row[0]] = row[1];
+  }
+  EXPECT_EQ("aggregate", report["query_type"]);
+  EXPECT_EQ("events", report["table"]);
+  EXPECT_EQ(1, report.count("execution"));
+  EXPECT_EQ(1, report.count("code_hash"));
+  EXPECT_EQ("1", report["output_recs"]);
+  EXPECT_EQ(1, report.count("wall_ms"));
+
+  if (report["execution"] == "compiled") {
+    EXPECT_EQ(1, report.count("aggregation"));
+    EXPECT_EQ("typed", report["sort"]);
+    EXPECT_EQ(1, report.count("stage.compile.wall_ms"));
+    EXPECT_EQ(1, report.count("stage.scan.cpu_ms"));
+    EXPECT_EQ(1, report.count("stage.sort.wall_ms"));
+  }
+}
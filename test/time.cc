@@ -586,6 +586,35 @@ TEST_F(TimeEvents, QueryGranularity) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST_F(TimeEvents, QueryGranularityWeek) {
+  LoadEvents();
+
+  query::MemoryRowOutput output;
+  db.Query(
+      std::move(util::Config(json{
+          {"type", "aggregate"},
+          {"table", "events"},
+          {"select",
+           {{{"column", "country"}},
+            {{"column", "install_time"},
+             {"format", "%Y-%m-%d %T"},
+             {"granularity", "week"}},
+            {{"column", "count"}}}},
+          {"filter", {{"op", "gt"}, {"column", "count"}, {"value", "0"}}}})),
+      output);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {
+      {"IL", "2014-12-29 00:00:00", "1"}, {"KZ", "2014-12-29 00:00:00", "1"},
+      {"KZ", "2015-01-05 00:00:00", "1"}, {"RU", "2014-12-29 00:00:00", "1"},
+      {"US", "2014-12-29 00:00:00", "2"}, {"US", "2015-01-05 00:00:00", "2"}};
+  auto actual = output.rows();
+
+  std::sort(expected.begin(), expected.end());
+  std::sort(actual.begin(), actual.end());
+
+  EXPECT_EQ(expected, actual);
+}
+
 TEST_F(TimeGranularitiesEvents, IngestRollupYear) {
   LoadEvents();
 
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2017 ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db.h"
+#include "input/simple.h"
+#include "query/output.h"
+#include "util/config.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+
+namespace util = viya::util;
+namespace query = viya::query;
+
+class ViewEvents : public testing::Test {
+protected:
+  ViewEvents()
+      : db(std::move(util::Config(json{
+            {"tables",
+             {{{"name", "events"},
+               {"dimensions",
+                {{{"name", "country"}},
+                 {{"name", "event_name"}},
+                 {{"name", "install_time"}, {"type", "time"}}}},
+               {"metrics",
+                {{{"name", "count"}, {"type", "count"}},
+                 {{"name", "revenue"}, {"type", "double_sum"}}}},
+               {"views",
+                {{{"name", "by_country"}, {"dimensions", {"country"}}},
+                 {{"name", "daily"},
+                  {"dimensions", {"country", "install_time"}},
+                  {"granularity", "day"}}}}}}}}))) {}
+
+  void LoadEvents() {
+    auto table = db.GetTable("events");
+    input::SimpleLoader loader(*table);
+    loader.Load({{"US", "purchase", "1420107084", "1.0"},
+                 {"RU", "support", "1420150284", "2.0"},
+                 {"US", "openapp", "1420178111", "3.0"},
+                 {"IL", "purchase", "1420287194", "4.0"},
+                 {"US", "purchase", "1420495805", "5.0"}});
+  }
+
+  std::vector<query::MemoryRowOutput::Row> Query(const json &query_conf,
+                                                 std::string &table) {
+    query::MemoryRowOutput output;
+    auto stats = db.Query(util::Config(query_conf), output);
+    table = stats.table_;
+    auto rows = output.rows();
+    std::sort(rows.begin(), rows.end());
+    return rows;
+  }
+
+  db::Database db;
+};
+
+TEST_F(ViewEvents, RouteToSmallestView) {
+  LoadEvents();
+
+  std::string table;
+  auto rows = Query(json{{"type", "aggregate"},
+                         {"table", "events"},
+                         {"dimensions", {"country"}},
+                         {"metrics", {"count", "revenue"}}},
+                    table);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {
+      {"IL", "1", "4"}, {"RU", "1", "2"}, {"US", "3", "9"}};
+  EXPECT_EQ(expected, rows);
+  EXPECT_EQ("events.by_country", table);
+}
+
+TEST_F(ViewEvents, RouteByGranularity) {
+  LoadEvents();
+
+  std::string table;
+  auto rows = Query(json{{"type", "aggregate"},
+                         {"table", "events"},
+                         {"select",
+                          {{{"column", "install_time"},
+                            {"format", "%Y-%m-%d"},
+                            {"granularity", "month"}},
+                           {{"column", "count"}}}}},
+                    table);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {{"2015-01-01", "5"}};
+  EXPECT_EQ(expected, rows);
+  EXPECT_EQ("events.daily", table);
+
+  // Hourly buckets are finer than the view buckets:
+  Query(json{{"type", "aggregate"},
+             {"table", "events"},
+             {"select",
+              {{{"column", "install_time"}, {"granularity", "hour"}},
+               {{"column", "count"}}}}},
+        table);
+  EXPECT_EQ("events", table);
+}
+
+TEST_F(ViewEvents, NotCoveredByViews) {
+  LoadEvents();
+
+  std::string table;
+  auto rows = Query(
+      json{{"type", "aggregate"},
+           {"table", "events"},
+           {"dimensions", {"country"}},
+           {"metrics", {"count"}},
+           {"filter",
+            {{"op", "eq"}, {"column", "event_name"}, {"value", "purchase"}}}},
+      table);
+
+  std::vector<query::MemoryRowOutput::Row> expected = {{"IL", "1"},
+                                                       {"US", "2"}};
+  EXPECT_EQ(expected, rows);
+  EXPECT_EQ("events", table);
+}
+
+TEST_F(ViewEvents, SearchDictionary) {
+  LoadEvents();
+
+  query::MemoryRowOutput output;
+  auto stats = db.Query(util::Config(json{{"type", "search"},
+                                          {"table", "events"},
+                                          {"dimension", "country"},
+                                          {"term", "U"}}),
+                        output);
+
+  // Views don't make dictionaries of their base table shared:
+  std::vector<query::MemoryRowOutput::Row> expected = {{"RU", "US"}};
+  auto actual = output.rows();
+  std::sort(actual[0].begin(), actual[0].end());
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(0, stats.scanned_recs);
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017 ViyaDB Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db.h"
+#include "query/output.h"
+#include "query/warmup.h"
+#include "util/config.h"
+#include <algorithm>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace util = viya::util;
+namespace query = viya::query;
+
+TEST(Warmup, RecordQueryShapes) {
+  char state_dir[] = "/tmp/viyadb-warmup-XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(state_dir));
+
+  util::Config db_conf(
+      json{{"state_dir", state_dir},
+           {"warmup_queries", 10},
+           {"tables",
+            {{{"name", "events"},
+              {"dimensions", {{{"name", "country"}}, {{"name", "event_name"}}}},
+              {"metrics", {{{"name", "count"}, {"type", "count"}}}}}}}});
+
+  auto query_conf = [](const std::string &country,
+                       const std::vector<std::string> &events) {
+    return util::Config(json{
+        {"type", "aggregate"},
+        {"table", "events"},
+        {"dimensions", {"event_name"}},
+        {"metrics", {"count"}},
+        {"filter",
+         {{"op", "and"},
+          {"filters",
+           {{{"op", "eq"}, {"column", "country"}, {"value", country}},
+            {{"op", "in"},
+             {"column", "event_name"},
+             {"values", events}}}}}}});
+  };
+
+  {
+    db::Database db(db_conf);
+    query::MemoryRowOutput output;
+    db.Query(query_conf("US", {"purchase", "refund"}), output);
+    auto other_conf = query_conf("IL", {"donate", "refund"});
+    other_conf.set_num("timeout", 60000);
+    other_conf.set_num("parallelism", 2);
+    db.Query(other_conf, output);
+    db.Query(util::Config(json{{"type", "aggregate"},
+                               {"table", "events"},
+                               {"dimensions", {"country"}},
+                               {"metrics", {"count"}}}),
+             output);
+
+    // Queries that differ in filter values and run-time options only have the
+    // same shape:
+    auto shapes = db.warmup().Shapes("events");
+    ASSERT_EQ(2, shapes.size());
+    EXPECT_EQ(query_conf("", {"", ""}).dump(), shapes[0].first.dump());
+    EXPECT_EQ(2, shapes[0].second);
+    EXPECT_EQ(1, shapes[1].second);
+  }
+
+  // Shapes are restored after restart, and replayed when the table is created:
+  db::Database db(db_conf);
+  auto shapes = db.warmup().Shapes("events");
+  ASSERT_EQ(2, shapes.size());
+  EXPECT_EQ(2, shapes[0].second);
+
+  // Pages of the same query have the same shape:
+  auto page_conf = [](const std::string &cursor, long limit) {
+    return util::Config(json{{"type", "select"},
+                             {"table", "events"},
+                             {"dimensions", {"country"}},
+                             {"limit", limit},
+                             {"cursor", cursor}});
+  };
+  db.warmup().Record(page_conf("", 10));
+  db.warmup().Record(page_conf("1:10", 20));
+  shapes = db.warmup().Shapes("events");
+  ASSERT_EQ(3, shapes.size());
+  auto page_shape = std::find_if(shapes.begin(), shapes.end(), [&](auto &s) {
+    return s.first.dump() == page_conf("", 1).dump();
+  });
+  ASSERT_NE(shapes.end(), page_shape);
+  EXPECT_EQ(2, page_shape->second);
+}